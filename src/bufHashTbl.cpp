@@ -8,85 +8,202 @@
 
 #include "bufHashTbl.h"
 
-#include <functional>
-#include <iostream>
-#include <memory>
-
 #include "buffer.h"
 #include "exceptions/hash_already_present_exception.h"
 #include "exceptions/hash_not_found_exception.h"
-#include "exceptions/hash_table_exception.h"
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File& file, const PageId pageNo) {
-  auto hash =
-      std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
-  return hash % HTSIZE;
+const std::uint64_t BufHashTbl::EMPTY;
+const std::uint64_t BufHashTbl::DELETED;
+
+BufHashTbl::BufHashTbl(int htSize)
+    : HTSIZE(slotsFor(htSize)),
+      ht(HTSIZE, hashBucket{EMPTY, 0}),
+      count(0),
+      migrated(0) {}
+
+int BufHashTbl::slotsFor(int htSize) {
+  int size = 1;
+  while (size < htSize) {
+    size *= 2;
+  }
+  return size;
 }
 
-BufHashTbl::BufHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {
-  // allocate an array of pointers to hashBuckets
+int BufHashTbl::find(const std::uint64_t key) const {
+  for (int i = hash(key, HTSIZE);; i = (i + 1) & (HTSIZE - 1)) {
+    if (ht[i].key == key) {
+      return i;
+    }
+    if (ht[i].key == EMPTY) {
+      return -1;
+    }
+  }
 }
 
-void BufHashTbl::insert(const File& file, const PageId pageNo,
-                        const FrameId frameNo) {
-  int index = hash(file, pageNo);
+int BufHashTbl::findOld(const std::uint64_t key) const {
+  if (oldHt.empty()) {
+    return -1;
+  }
+  const int size = oldHt.size();
+  for (int i = hash(key, size);; i = (i + 1) & (size - 1)) {
+    if (oldHt[i].key == EMPTY) {
+      return -1;
+    }
+    if (oldHt[i].key == key && i >= migrated) {
+      return i;
+    }
+  }
+}
 
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-      throw HashAlreadyPresentException(tmpBuc->file.filename(), tmpBuc->pageNo,
-                                        tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+void BufHashTbl::place(const std::uint64_t key, const FrameId frameNo) {
+  int i = hash(key, HTSIZE);
+  while (ht[i].key != EMPTY) {
+    i = (i + 1) & (HTSIZE - 1);
   }
+  ht[i].key = key;
+  ht[i].frameNo = frameNo;
+  count++;
+}
 
-  tmpBuc = std::make_shared<hashBucket>();
-  if (!tmpBuc) throw HashTableException();
+void BufHashTbl::rehash(int htSize) {
+  std::vector<hashBucket> entries;
+  entries.reserve(count);
+  for (const hashBucket& b : ht) {
+    if (b.key != EMPTY) {
+      entries.push_back(b);
+    }
+  }
+  for (int i = migrated; i < static_cast<int>(oldHt.size()); i++) {
+    if (oldHt[i].key < DELETED) {
+      entries.push_back(oldHt[i]);
+    }
+  }
+  std::vector<hashBucket>().swap(oldHt);
+  migrated = 0;
 
-  tmpBuc->file = file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  // keep the table at most three quarters full
+  while (htSize * 3 < (static_cast<int>(entries.size()) + 1) * 4) {
+    htSize *= 2;
+  }
+  HTSIZE = htSize;
+  ht.assign(htSize, hashBucket{EMPTY, 0});
+  count = 0;
+  for (const hashBucket& b : entries) {
+    place(b.key, b.frameNo);
+  }
 }
 
-void BufHashTbl::lookup(const File& file, const PageId pageNo,
-                        FrameId& frameNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      frameNo = tmpBuc->frameNo;  // return frameNo by reference
+void BufHashTbl::migrate(int buckets) {
+  for (; buckets > 0 && migrated < static_cast<int>(oldHt.size());
+       buckets--, migrated++) {
+    const hashBucket& b = oldHt[migrated];
+    if (b.key >= DELETED) {
+      continue;
+    }
+    if ((count + 1) * 4 > HTSIZE * 3) {
+      // moves the rest of oldHt as well
+      rehash(HTSIZE * 2);
       return;
     }
-    tmpBuc = tmpBuc->next;
+    place(b.key, b.frameNo);
+  }
+  if (!oldHt.empty() && migrated == static_cast<int>(oldHt.size())) {
+    std::vector<hashBucket>().swap(oldHt);
+    migrated = 0;
   }
+}
 
-  throw HashNotFoundException(file.filename(), pageNo);
+void BufHashTbl::resize(const int htSize) {
+  migrate(oldHt.size());
+  oldHt.swap(ht);
+  migrated = 0;
+  HTSIZE = slotsFor(htSize);
+  ht.assign(HTSIZE, hashBucket{EMPTY, 0});
+  count = 0;
+}
+
+void BufHashTbl::insert(const File& file, const PageId pageNo,
+                        const FrameId frameNo) {
+  if (!tryInsert(file, pageNo, frameNo)) {
+    FrameId present = 0;
+    tryLookup(file, pageNo, present);
+    throw HashAlreadyPresentException(file.filename(), pageNo, present);
+  }
+}
+
+bool BufHashTbl::tryInsert(const File& file, const PageId pageNo,
+                           const FrameId frameNo) {
+  migrate(MIGRATE_STEP);
+  const std::uint64_t k = key(file, pageNo);
+  if (find(k) >= 0 || findOld(k) >= 0) {
+    return false;
+  }
+  if ((count + 1) * 4 > HTSIZE * 3) {
+    rehash(HTSIZE * 2);
+  }
+  place(k, frameNo);
+  return true;
+}
+
+void BufHashTbl::lookup(const File& file, const PageId pageNo,
+                        FrameId& frameNo) {
+  if (!tryLookup(file, pageNo, frameNo)) {
+    throw HashNotFoundException(file.filename(), pageNo);
+  }
+}
+
+bool BufHashTbl::tryLookup(const File& file, const PageId pageNo,
+                           FrameId& frameNo) {
+  migrate(MIGRATE_STEP);
+  const std::uint64_t k = key(file, pageNo);
+  int i = find(k);
+  if (i >= 0) {
+    frameNo = ht[i].frameNo;  // return frameNo by reference
+    return true;
+  }
+  i = findOld(k);
+  if (i >= 0) {
+    frameNo = oldHt[i].frameNo;
+    return true;
+  }
+  return false;
 }
 
 void BufHashTbl::remove(const File& file, const PageId pageNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  std::shared_ptr<hashBucket> prevBuc;
-
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (prevBuc)
-        prevBuc->next = tmpBuc->next;
-      else
-        ht[index] = tmpBuc->next;
-
-      tmpBuc.reset();
-      return;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  if (!tryRemove(file, pageNo)) {
+    throw HashNotFoundException(file.filename(), pageNo);
+  }
+}
+
+bool BufHashTbl::tryRemove(const File& file, const PageId pageNo) {
+  migrate(MIGRATE_STEP);
+  const std::uint64_t k = key(file, pageNo);
+  int i = find(k);
+  if (i < 0) {
+    i = findOld(k);
+    if (i < 0) {
+      return false;
     }
+    // later entries of the old probe run are found through the marker
+    oldHt[i].key = DELETED;
+    return true;
   }
 
-  throw HashNotFoundException(file.filename(), pageNo);
+  // shift the rest of the probe run back over the hole, skipping entries
+  // whose probe run starts after the hole
+  const int mask = HTSIZE - 1;
+  for (int j = (i + 1) & mask; ht[j].key != EMPTY; j = (j + 1) & mask) {
+    const int home = hash(ht[j].key, HTSIZE);
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      ht[i] = ht[j];
+      i = j;
+    }
+  }
+  ht[i].key = EMPTY;
+  count--;
+  return true;
 }
 
 }  // namespace badgerdb
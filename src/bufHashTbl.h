@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "file.h"
@@ -19,54 +20,142 @@ namespace badgerdb {
  */
 struct hashBucket {
   /**
-   * pointer a file object (more on this below)
+   * number of the file in the upper half, page number within the file in the
+   * lower half; EMPTY or DELETED if the slot holds no page
    */
-  File file;
-
-  /**
-   * page number within a file
-   */
-  PageId pageNo;
+  std::uint64_t key;
 
   /**
    * frame number of page in the buffer pool
    */
   FrameId frameNo;
-
-  /**
-   * Next node in the hash table
-   */
-  std::shared_ptr<hashBucket> next;
 };
 
 /**
  * @brief Hash table class to keep track of pages in the buffer pool
  *
- * @warning This class is not threadsafe.
+ * Entries are stored inline in a power of two array of slots and found by
+ * linear probing, so an insert allocates nothing and a lookup usually reads
+ * one or two cache lines.  Removal shifts the following entries of the probe
+ * run back instead of leaving a marker, so lookups never scan past deleted
+ * entries.  The table doubles when it is three quarters full.
+ *
+ * The table can be resized.  Entries are then moved from the old to the new
+ * slot array a few slots at a time by every following operation, so no
+ * single operation pays for rehashing the whole table.  Until a slot of the
+ * old array has been moved, lookups probe the old array as well.
+ *
+ * @warning This class is not threadsafe; see ConcurrentPageTable for a table
+ * that threads can share.
  */
 class BufHashTbl {
  private:
   /**
-   *	Size of Hash Table
+   * Number of old slots each operation moves while a resize is in progress
+   */
+  static const int MIGRATE_STEP = 4;
+
+  /**
+   * Key of a slot that never held an entry; ends a probe run
+   */
+  static const std::uint64_t EMPTY = ~std::uint64_t(0);
+
+  /**
+   * Key of a slot of the old array whose entry was removed before it was
+   * moved; does not end a probe run
+   */
+  static const std::uint64_t DELETED = ~std::uint64_t(0) - 1;
+
+  /**
+   *	Number of slots, a power of two
    */
   int HTSIZE;
+
   /**
    * Actual Hash table object
    */
-  std::vector<std::shared_ptr<hashBucket>> ht;
+  std::vector<hashBucket> ht;
+
+  /**
+   * Number of entries in ht
+   */
+  int count;
+
+  /**
+   * Slot array being migrated away from; empty if no resize is in progress
+   */
+  std::vector<hashBucket> oldHt;
 
   /**
-   * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+   * Number of slots of oldHt that have been moved into ht.  Entries at lower
+   * indices are only in ht, even though their keys are left in oldHt so that
+   * probe runs through them stay intact.
+   */
+  int migrated;
+
+  /**
+   * returns the key of (file, pageNo) stored in the slots
    *
    * @param file   	File object
    * @param pageNo  Page number in the file
+   * @return  			Key combining file.id() and pageNo.
+   */
+  static std::uint64_t key(const File& file, const PageId pageNo) {
+    return (std::uint64_t(file.id()) << 32) | pageNo;
+  }
+
+  /**
+   * returns the slot between 0 and size-1 a key's probe run starts at
+   *
+   * @param key     Key returned by key()
+   * @param size    Number of slots, a power of two
    * @return  			Hash value.
    */
-  int hash(const File& file, const PageId pageNo);
+  static int hash(const std::uint64_t key, int size) {
+    // Fibonacci hashing: the top bits of the product depend on all of the key
+    return (key * 0x9E3779B97F4A7C15ull) >> 32 & (size - 1);
+  }
+
+  /**
+   * Returns the index of the key in ht, or -1.
+   */
+  int find(const std::uint64_t key) const;
+
+  /**
+   * Returns the index of the key in the part of oldHt not yet moved, or -1.
+   */
+  int findOld(const std::uint64_t key) const;
+
+  /**
+   * Store an entry in ht, which must not hold the key yet.
+   */
+  void place(const std::uint64_t key, const FrameId frameNo);
+
+  /**
+   * Replace ht by an empty array of the given number of slots and move its
+   * entries over at once.  A resize in progress is completed first.
+   *
+   * @param htSize  New number of slots, a power of two
+   */
+  void rehash(int htSize);
+
+  /**
+   * Move up to the given number of slots of oldHt into ht.
+   *
+   * @param buckets Number of slots to move
+   */
+  void migrate(int buckets);
+
+  /**
+   * Returns the smallest power of two that is at least the given size.
+   */
+  static int slotsFor(int htSize);
 
  public:
   /**
    * Constructor of BufHashTbl class
+   *
+   * @param htSize  Minimum number of slots; rounded up to a power of two
    */
   BufHashTbl(const int htSize);  // constructor
 
@@ -78,11 +167,20 @@ class BufHashTbl {
    * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page
    * already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as
-   * running of memory
    */
   void insert(const File& file, const PageId pageNo, const FrameId frameNo);
 
+  /**
+   * Insert entry into hash table mapping (file, pageNo) to frameNo, unless
+   * the page is already in the table.
+   *
+   * @param file   	File object
+   * @param pageNo 	Page number in the file
+   * @param frameNo Frame number assigned to that page of the file
+   * @return        False if the page already exists in the hash table
+   */
+  bool tryInsert(const File& file, const PageId pageNo, const FrameId frameNo);
+
   /**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
    * the hash table).
@@ -95,6 +193,17 @@ class BufHashTbl {
    */
   void lookup(const File& file, const PageId pageNo, FrameId& frameNo);
 
+  /**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table), without throwing if it is not.
+   *
+   * @param file  	File object
+   * @param pageNo	Page number in the file
+   * @param frameNo Frame number reference, set if the page is found
+   * @return        False if the page entry is not found in the hash table
+   */
+  bool tryLookup(const File& file, const PageId pageNo, FrameId& frameNo);
+
   /**
    * Delete entry (file,pageNo) from hash table.
    *
@@ -104,6 +213,23 @@ class BufHashTbl {
    * table
    */
   void remove(const File& file, const PageId pageNo);
+
+  /**
+   * Delete entry (file,pageNo) from hash table, if it is there.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @return        False if the page entry is not found in the hash table
+   */
+  bool tryRemove(const File& file, const PageId pageNo);
+
+  /**
+   * Change the number of slots.  A resize still in progress is completed
+   * first; the entries are then moved over by later operations.
+   *
+   * @param htSize  Minimum number of slots; rounded up to a power of two
+   */
+  void resize(const int htSize);
 };
 
 }  // namespace badgerdb
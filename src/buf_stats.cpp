@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "buf_stats.h"
+
+#include <tuple>
+#include <utility>
+
+namespace badgerdb {
+
+namespace {
+
+const int NUM_STATS = static_cast<int>(BufStat::COUNT);
+
+/**
+ * Source of BufStatsCollector identifiers; 0 is never handed out.
+ */
+std::atomic<std::uint64_t> nextCollectorId(1);
+
+BufStats toBufStats(const std::vector<std::uint64_t>& values) {
+  BufStats stats;
+  stats.accesses = values[static_cast<int>(BufStat::ACCESSES)];
+  stats.hits = values[static_cast<int>(BufStat::HITS)];
+  stats.misses = values[static_cast<int>(BufStat::MISSES)];
+  stats.diskreads = values[static_cast<int>(BufStat::DISK_READS)];
+  stats.diskwrites = values[static_cast<int>(BufStat::DISK_WRITES)];
+  stats.allocs = values[static_cast<int>(BufStat::ALLOCS)];
+  stats.evictions = values[static_cast<int>(BufStat::EVICTIONS)];
+  stats.writeBacks = values[static_cast<int>(BufStat::WRITE_BACKS)];
+  stats.sweepSteps = values[static_cast<int>(BufStat::SWEEP_STEPS)];
+  stats.victimSearches = values[static_cast<int>(BufStat::VICTIM_SEARCHES)];
+  stats.bufferExceeded = values[static_cast<int>(BufStat::BUFFER_EXCEEDED)];
+  return stats;
+}
+
+}  // namespace
+
+BufStatsCollector::Counters::Counters() {
+  for (int i = 0; i < NUM_STATS; i++) {
+    values[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+BufStatsCollector::BufStatsCollector() : id(nextCollectorId++) {}
+
+BufStatsCollector::ThreadCounters& BufStatsCollector::local() {
+  // Collectors this thread has counted for.  Entries are never removed, but a
+  // destroyed collector's identifier is never reused, so a stale entry is
+  // merely unused.
+  thread_local std::unordered_map<std::uint64_t,
+                                  std::shared_ptr<ThreadCounters>>
+      mine;
+  thread_local std::uint64_t lastId = 0;
+  thread_local ThreadCounters* last = NULL;
+
+  if (lastId != id) {
+    std::shared_ptr<ThreadCounters>& counters = mine[id];
+    if (!counters) {
+      counters = std::make_shared<ThreadCounters>();
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.push_back(counters);
+    }
+    lastId = id;
+    last = counters.get();
+  }
+  return *last;
+}
+
+void BufStatsCollector::count(const File& file, BufStat stat,
+                              std::uint64_t n) {
+  ThreadCounters& local_counters = local();
+  if (local_counters.lastCounters == NULL ||
+      local_counters.lastFile != file.id()) {
+    const std::string& name = file.filename();
+    auto it = local_counters.files.find(name);
+    if (it == local_counters.files.end()) {
+      std::lock_guard<std::mutex> lock(local_counters.mutex);
+      it = local_counters.files
+               .emplace(std::piecewise_construct, std::forward_as_tuple(name),
+                        std::forward_as_tuple())
+               .first;
+    }
+    local_counters.lastFile = file.id();
+    local_counters.lastCounters = &it->second;
+  }
+
+  // Only this thread writes the counter, so no read-modify-write is needed.
+  std::atomic<std::uint64_t>& value =
+      local_counters.lastCounters->values[static_cast<int>(stat)];
+  value.store(value.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+}
+
+std::map<std::string, std::vector<std::uint64_t>> BufStatsCollector::sum()
+    const {
+  std::map<std::string, std::vector<std::uint64_t>> sums;
+  for (const std::shared_ptr<ThreadCounters>& thread : threads) {
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    for (const auto& file : thread->files) {
+      std::vector<std::uint64_t>& values = sums[file.first];
+      values.resize(NUM_STATS, 0);
+      for (int i = 0; i < NUM_STATS; i++) {
+        values[i] += file.second.values[i].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return sums;
+}
+
+std::map<std::string, BufStats> BufStatsCollector::byFile() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, BufStats> stats;
+  for (auto& file : sum()) {
+    auto base = baseline.find(file.first);
+    if (base != baseline.end()) {
+      for (int i = 0; i < NUM_STATS; i++) {
+        file.second[i] -= base->second[i];
+      }
+    }
+    stats[file.first] = toBufStats(file.second);
+  }
+  return stats;
+}
+
+BufStats BufStatsCollector::total() const {
+  BufStats total;
+  for (const auto& file : byFile()) {
+    const BufStats& stats = file.second;
+    total.accesses += stats.accesses;
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.diskreads += stats.diskreads;
+    total.diskwrites += stats.diskwrites;
+    total.allocs += stats.allocs;
+    total.evictions += stats.evictions;
+    total.writeBacks += stats.writeBacks;
+    total.sweepSteps += stats.sweepSteps;
+    total.victimSearches += stats.victimSearches;
+    total.bufferExceeded += stats.bufferExceeded;
+  }
+  return total;
+}
+
+void BufStatsCollector::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  baseline = sum();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,233 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Events counted by BufStatsCollector.
+ */
+enum class BufStat {
+  ACCESSES,
+  HITS,
+  MISSES,
+  DISK_READS,
+  DISK_WRITES,
+  ALLOCS,
+  EVICTIONS,
+  WRITE_BACKS,
+  SWEEP_STEPS,
+  VICTIM_SEARCHES,
+  BUFFER_EXCEEDED,
+
+  /**
+   * Number of events, not an event itself
+   */
+  COUNT
+};
+
+/**
+ * @brief Class to maintain statistics of buffer usage
+ */
+struct BufStats {
+  /**
+   * Total number of accesses to buffer pool
+   */
+  std::uint64_t accesses;
+
+  /**
+   * Number of pages read from disk
+   */
+  std::uint64_t diskreads;
+
+  /**
+   * Number of pages written back to disk
+   */
+  std::uint64_t diskwrites;
+
+  /**
+   * Number of pages allocated through the buffer pool, which are laid out in
+   * their frames without a disk read
+   */
+  std::uint64_t allocs;
+
+  /**
+   * Number of accesses that found the page in the buffer pool
+   */
+  std::uint64_t hits;
+
+  /**
+   * Number of accesses that had to read the page from disk
+   */
+  std::uint64_t misses;
+
+  /**
+   * Number of pages evicted to make room for another page
+   */
+  std::uint64_t evictions;
+
+  /**
+   * Number of evicted pages that were dirty and had to be written out
+   * before their frame could be reused
+   */
+  std::uint64_t writeBacks;
+
+  /**
+   * Number of frames the replacement policy looked at while searching for
+   * victims
+   */
+  std::uint64_t sweepSteps;
+
+  /**
+   * Number of searches for a victim; sweepSteps / victimSearches is the
+   * average sweep length per allocation
+   */
+  std::uint64_t victimSearches;
+
+  /**
+   * Number of times BufferExceededException was raised
+   */
+  std::uint64_t bufferExceeded;
+
+  /**
+   * Clear all values
+   */
+  void clear() {
+    accesses = diskreads = diskwrites = allocs = 0;
+    hits = misses = evictions = writeBacks = 0;
+    sweepSteps = victimSearches = bufferExceeded = 0;
+  }
+
+  /**
+   * Constructor of BufStats class
+   */
+  BufStats() { clear(); }
+};
+
+/**
+ * @brief Per file buffer usage counters that are cheap to update.
+ *
+ * Every thread counts into its own set of counters, which only that thread
+ * writes, so counting is a plain load and store without contention.  Reading
+ * the statistics sums the counters of every thread that ever counted.
+ */
+class BufStatsCollector {
+ public:
+  /**
+   * Constructor of BufStatsCollector class
+   */
+  BufStatsCollector();
+
+  BufStatsCollector(const BufStatsCollector&) = delete;
+  BufStatsCollector& operator=(const BufStatsCollector&) = delete;
+
+  /**
+   * Count an event for a file in the calling thread's counters.
+   *
+   * @param file    File the event concerns
+   * @param stat    Event
+   * @param n       Number of events
+   */
+  void count(const File& file, BufStat stat, std::uint64_t n = 1);
+
+  /**
+   * Returns the statistics of all files, counted since the last clear().
+   */
+  BufStats total() const;
+
+  /**
+   * Returns the statistics of every file that had events counted, by file
+   * name, counted since the last clear().
+   */
+  std::map<std::string, BufStats> byFile() const;
+
+  /**
+   * Start counting from zero.
+   */
+  void clear();
+
+ private:
+  /**
+   * Counters of one file in one thread
+   */
+  struct Counters {
+    Counters();
+
+    std::atomic<std::uint64_t> values[static_cast<int>(BufStat::COUNT)];
+  };
+
+  /**
+   * Counters of one thread
+   */
+  struct ThreadCounters {
+    ThreadCounters() : lastFile(0), lastCounters(NULL) {}
+
+    /**
+     * Held by the owning thread while it adds a file, and by readers.  The
+     * owning thread looks files up without it, since only it adds them.
+     */
+    std::mutex mutex;
+
+    /**
+     * Counters by file name
+     */
+    std::unordered_map<std::string, Counters> files;
+
+    /**
+     * Number and counters of the file counted last, to skip the lookup
+     */
+    FileId lastFile;
+    Counters* lastCounters;
+  };
+
+  /**
+   * Returns the calling thread's counters, registering them on first use.
+   */
+  ThreadCounters& local();
+
+  /**
+   * Sums the counters of every thread by file, without subtracting baseline.
+   * The caller must hold mutex.
+   */
+  std::map<std::string, std::vector<std::uint64_t>> sum() const;
+
+  /**
+   * Unique identifier of this collector, used to find the calling thread's
+   * counters
+   */
+  const std::uint64_t id;
+
+  /**
+   * Guards threads and baseline
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Counters of every thread that counted an event
+   */
+  std::vector<std::shared_ptr<ThreadCounters>> threads;
+
+  /**
+   * Sums at the last clear(), by file name
+   */
+  std::map<std::string, std::vector<std::uint64_t>> baseline;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,187 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "buf_trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "exceptions/bad_trace_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+const char MAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+const std::uint32_t VERSION = 1;
+
+/**
+ * Record that numbers a file; not an event.
+ */
+const std::uint8_t FILE_RECORD = 0;
+
+/**
+ * Flag of an UNPIN event that marked the page dirty.
+ */
+const std::uint8_t DIRTY_FLAG = 1;
+
+/**
+ * Number of buffered bytes at which the buffer is written out.
+ */
+const std::size_t FLUSH_BYTES = 64 * 1024;
+
+}  // namespace
+
+const std::size_t BufTraceWriter::MAX_NAME;
+
+BufTraceWriter::BufTraceWriter(const std::string& path)
+    : path_(path),
+      out_(path.c_str(),
+           std::ios::out | std::ios::binary | std::ios::trunc) {
+  if (!out_) {
+    throw BadTraceException(path, "cannot be created");
+  }
+  buffer_.insert(buffer_.end(), MAGIC, MAGIC + sizeof(MAGIC));
+  put32(VERSION);
+}
+
+BufTraceWriter::~BufTraceWriter() { flush(); }
+
+void BufTraceWriter::record(BufTraceOp op, const std::string& file,
+                            PageId pageNo, bool dirty) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!out_.is_open()) {
+    return;
+  }
+  auto it = files_.find(file);
+  if (it == files_.end()) {
+    it = files_.emplace(file, files_.size()).first;
+    const std::size_t size = std::min(file.size(), MAX_NAME);
+    put8(FILE_RECORD);
+    put32(it->second);
+    put16(size);
+    buffer_.insert(buffer_.end(), file.begin(), file.begin() + size);
+  }
+  put8(static_cast<std::uint8_t>(op));
+  put8(dirty ? DIRTY_FLAG : 0);
+  put32(it->second);
+  put32(pageNo);
+  if (buffer_.size() >= FLUSH_BYTES) {
+    flushLocked();
+  }
+}
+
+void BufTraceWriter::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  flushLocked();
+}
+
+void BufTraceWriter::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!out_.is_open()) {
+    return;
+  }
+  flushLocked();
+  const bool written = out_.good();
+  out_.close();
+  if (!written || out_.fail()) {
+    throw FileIOException(path_, "trace could not be written");
+  }
+}
+
+void BufTraceWriter::flushLocked() {
+  if (out_.is_open() && out_.good()) {
+    out_.write(buffer_.data(), buffer_.size());
+    out_.flush();
+  }
+  buffer_.clear();
+}
+
+void BufTraceWriter::put8(std::uint8_t value) { buffer_.push_back(value); }
+
+void BufTraceWriter::put16(std::uint16_t value) {
+  put8(value & 0xFF);
+  put8(value >> 8);
+}
+
+void BufTraceWriter::put32(std::uint32_t value) {
+  put16(value & 0xFFFF);
+  put16(value >> 16);
+}
+
+BufTraceReader::BufTraceReader(const std::string& path)
+    : path_(path), in_(path.c_str(), std::ios::in | std::ios::binary) {
+  if (!in_) {
+    throw FileNotFoundException(path_);
+  }
+  char magic[sizeof(MAGIC)];
+  if (!in_.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw BadTraceException(path_, "not a buffer access trace");
+  }
+  if (get32() != VERSION) {
+    throw BadTraceException(path_, "unsupported version");
+  }
+}
+
+bool BufTraceReader::next(BufTraceEvent& event) {
+  while (true) {
+    const int op = in_.get();
+    if (op == std::char_traits<char>::eof()) {
+      return false;
+    }
+    if (op == FILE_RECORD) {
+      const std::uint32_t number = get32();
+      std::string name(get16(), '\0');
+      get(&name[0], name.size());
+      if (number != files_.size()) {
+        throw BadTraceException(path_, "files are out of order");
+      }
+      files_.push_back(name);
+      continue;
+    }
+    if (op < static_cast<int>(BufTraceOp::READ) ||
+        op > static_cast<int>(BufTraceOp::FLUSH)) {
+      throw BadTraceException(path_, "unknown event");
+    }
+    event.op = static_cast<BufTraceOp>(op);
+    event.dirty = (get8() & DIRTY_FLAG) != 0;
+    event.file = get32();
+    event.pageNo = get32();
+    if (event.file >= files_.size()) {
+      throw BadTraceException(path_, "event for an unknown file");
+    }
+    return true;
+  }
+}
+
+void BufTraceReader::get(char* bytes, std::size_t count) {
+  if (!in_.read(bytes, count)) {
+    throw BadTraceException(path_, "truncated");
+  }
+}
+
+std::uint8_t BufTraceReader::get8() {
+  char byte;
+  get(&byte, 1);
+  return static_cast<std::uint8_t>(byte);
+}
+
+std::uint16_t BufTraceReader::get16() {
+  const std::uint16_t low = get8();
+  return low | (std::uint16_t(get8()) << 8);
+}
+
+std::uint32_t BufTraceReader::get32() {
+  const std::uint32_t low = get16();
+  return low | (std::uint32_t(get16()) << 16);
+}
+
+}  // namespace badgerdb
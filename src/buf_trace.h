@@ -0,0 +1,229 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Buffer manager calls recorded in an access trace.
+ */
+enum class BufTraceOp : std::uint8_t {
+  /**
+   * readPage(), or a page of readPages(); pins the page
+   */
+  READ = 1,
+
+  /**
+   * allocPage(); pins the new page
+   */
+  ALLOC = 2,
+
+  /**
+   * unPinPage(), or a page of unPinPages()
+   */
+  UNPIN = 3,
+
+  /**
+   * disposePage()
+   */
+  DISPOSE = 4,
+
+  /**
+   * flushFile(); the page number is not used
+   */
+  FLUSH = 5
+};
+
+/**
+ * @brief One event of an access trace.
+ */
+struct BufTraceEvent {
+  /**
+   * Call that was made
+   */
+  BufTraceOp op;
+
+  /**
+   * Index of the file in BufTraceReader::files()
+   */
+  std::uint32_t file;
+
+  /**
+   * Page the call was made for
+   */
+  PageId pageNo;
+
+  /**
+   * True if an UNPIN marked the page dirty
+   */
+  bool dirty;
+};
+
+/**
+ * @brief Writes a compact binary trace of buffer manager calls.
+ *
+ * A trace starts with a header, followed by one record per event.  An event
+ * takes 10 bytes: the operation, a flags byte, a file number and a page
+ * number, little endian.  A file is numbered the first time it appears, with
+ * a record that holds its name, cut to MAX_NAME bytes.
+ *
+ * Events are buffered in memory and appended to the trace file in blocks.
+ * A failed write does not stop the calls being traced; close() reports it.
+ * The class is threadsafe.
+ */
+class BufTraceWriter {
+ public:
+  /**
+   * Longest file name a trace holds, in bytes
+   */
+  static const std::size_t MAX_NAME = 0xFFFF;
+
+  /**
+   * Creates the trace file, replacing any existing file of that name.
+   *
+   * @param path  Name of the trace file
+   * @throws BadTraceException If the file cannot be created
+   */
+  explicit BufTraceWriter(const std::string& path);
+
+  /**
+   * Writes out the buffered events and closes the trace file, if close()
+   * has not.  Write failures are not reported.
+   */
+  ~BufTraceWriter();
+
+  BufTraceWriter(const BufTraceWriter&) = delete;
+  BufTraceWriter& operator=(const BufTraceWriter&) = delete;
+
+  /**
+   * Appends an event.
+   *
+   * @param op      Call that was made
+   * @param file    Name of the file the call was made for
+   * @param pageNo  Page the call was made for
+   * @param dirty   True if an unpin marked the page dirty
+   */
+  void record(BufTraceOp op, const std::string& file, PageId pageNo,
+              bool dirty = false);
+
+  /**
+   * Writes out the buffered events.
+   */
+  void flush();
+
+  /**
+   * Writes out the buffered events and closes the trace file.  Events
+   * recorded afterwards are dropped.
+   *
+   * @throws FileIOException If any part of the trace could not be written
+   */
+  void close();
+
+ private:
+  /**
+   * Writes out the buffered events.  The caller must hold mutex_.
+   */
+  void flushLocked();
+
+  void put8(std::uint8_t value);
+  void put16(std::uint16_t value);
+  void put32(std::uint32_t value);
+
+  /**
+   * Guards all other members.
+   */
+  std::mutex mutex_;
+
+  /**
+   * Name of the trace file.
+   */
+  const std::string path_;
+
+  /**
+   * Trace file.  Once a write fails, it stays failed.
+   */
+  std::ofstream out_;
+
+  /**
+   * Encoded events not yet written to out_.
+   */
+  std::vector<char> buffer_;
+
+  /**
+   * Numbers of the files that appeared so far, by name.
+   */
+  std::unordered_map<std::string, std::uint32_t> files_;
+};
+
+/**
+ * @brief Reads back a trace made by BufTraceWriter.
+ */
+class BufTraceReader {
+ public:
+  /**
+   * Opens a trace file and checks its header.
+   *
+   * @param path  Name of the trace file
+   * @throws FileNotFoundException If the file does not exist
+   * @throws BadTraceException If the file is not a trace
+   */
+  explicit BufTraceReader(const std::string& path);
+
+  /**
+   * Reads the next event.
+   *
+   * @param event   Event reference, event returned via this variable
+   * @return        False at the end of the trace
+   * @throws BadTraceException If the trace is truncated or corrupt
+   */
+  bool next(BufTraceEvent& event);
+
+  /**
+   * Returns the names of the files that appeared in the events read so far,
+   * indexed by BufTraceEvent::file.
+   */
+  const std::vector<std::string>& files() const { return files_; }
+
+ private:
+  /**
+   * Reads bytes, failing if the trace ends first.
+   */
+  void get(char* bytes, std::size_t count);
+
+  std::uint8_t get8();
+  std::uint16_t get16();
+  std::uint32_t get32();
+
+  /**
+   * Name of the trace file.
+   */
+  std::string path_;
+
+  /**
+   * Trace file.
+   */
+  std::ifstream in_;
+
+  /**
+   * Names of the files seen so far.
+   */
+  std::vector<std::string> files_;
+};
+
+}  // namespace badgerdb
@@ -8,10 +8,16 @@
 
 #include "buffer.h"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 #include "exceptions/bad_buffer_exception.h"
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/hash_not_found_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
@@ -23,192 +29,1667 @@
 namespace badgerdb
 {
 
-  constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
+  // the page table stays at most half full with a page in every frame
+  constexpr int HASHTABLE_SZ(int bufs) { return bufs * 2; }
+
+  //----------------------------------------
+  // Constructor of the class BufShard
+  //----------------------------------------
+
+  BufShard::BufShard(std::uint32_t frames, ReplacementPolicyType policy)
+      : numFrames(frames),
+        policy(makeReplacementPolicy(policy, frames)),
+        numUnpinned(0),
+        numDirty(0),
+        writerHand(0),
+        hashTable(HASHTABLE_SZ(frames))
+  {
+    // hand out the lowest frames first
+    for (std::uint32_t i = frames; i > 0; i--)
+    {
+      freeFrames.push_back(i - 1);
+    }
+  }
+
+  //----------------------------------------
+  // Constructor of the class BufAccessStrategy
+  //----------------------------------------
+
+  BufAccessStrategy::BufAccessStrategy(const BufMgr &bufMgr,
+                                       std::uint32_t frames)
+      : rings(bufMgr.numShards), frames(frames), cursors(bufMgr.numShards, 0)
+  {
+  }
+
+  const FrameId SwizzledPageRef::NOT_SWIZZLED;
+
+  SwizzledPageRef::SwizzledPageRef(const File &file, PageId pageNo)
+      : file_(file), page_no_(pageNo), key_(BufMgr::pageKey(file, pageNo)),
+        frame_(NOT_SWIZZLED), mgr_(NULL)
+  {
+  }
+
+  SwizzledPageRef::~SwizzledPageRef()
+  {
+    BufMgr *mgr = mgr_.load(std::memory_order_acquire);
+    if (mgr)
+    {
+      mgr->unswizzle(*this);
+    }
+  }
+
+  const std::uint32_t BufMgr::GROWTH_FACTOR;
+  const std::uint32_t BufMgr::CHECKPOINT_BATCH;
+  const std::uint32_t BufMgr::PREFETCH_BATCH;
+  const int BufMgr::OPTIMISTIC_ATTEMPTS;
 
   //----------------------------------------
   // Constructor of the class BufMgr
   //----------------------------------------
 
-  BufMgr::BufMgr(std::uint32_t bufs)
-      : numBufs(bufs),
-        hashTable(HASHTABLE_SZ(bufs)),
-        bufDescTable(bufs),
-        bufPool(bufs)
-  {
-    for (FrameId i = 0; i < bufs; i++)
+  BufMgr::BufMgr(std::uint32_t bufs, std::uint32_t shards,
+                 ReplacementPolicyType policy,
+                 const BufWriterConfig &writerSettings, bool hugePages,
+                 std::uint32_t maxBufs)
+      : numBufs(bufs),
+        numShards(std::max(1u, std::min(shards, bufs))),
+        missRatio(bufs),
+        pageTable(HASHTABLE_SZ(bufs)),
+        tracing(false),
+        writerConfig(writerSettings),
+        stopWriter(false),
+        stopPrefetch(false),
+        scanThreshold(std::max(32u, bufs / 4)),
+        scanRingFrames(32),
+        bufPool(bufs, hugePages,
+                maxBufs ? maxBufs
+                        : std::uint32_t(std::min<std::uint64_t>(
+                              std::uint64_t(bufs) * GROWTH_FACTOR,
+                              std::numeric_limits<std::uint32_t>::max())))
+  {
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      // shard s owns every frame f with f % numShards == s
+      std::uint32_t frames = bufs / numShards + (s < bufs % numShards ? 1 : 0);
+      this->shards.emplace_back(new BufShard(frames, policy));
+      this->shards[s]->descs.resize(frames);
+      for (std::uint32_t i = 0; i < frames; i++)
+      {
+        this->shards[s]->descs[i].frameNo = frameOf(s, i);
+      }
+    }
+
+    if (writerConfig.enabled)
+    {
+      writer = std::thread(&BufMgr::writerLoop, this);
+    }
+  }
+
+  BufMgr::~BufMgr()
+  {
+    {
+      std::lock_guard<std::mutex> lock(prefetchMutex);
+      stopPrefetch = true;
+    }
+    prefetchWake.notify_all();
+    if (prefetcher.joinable())
+    {
+      prefetcher.join();
+    }
+
+    if (writer.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopWriter = true;
+      }
+      writerWake.notify_all();
+      writer.join();
+    }
+
+    // leave no reference pointing at this buffer manager
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      std::lock_guard<std::mutex> lock(shards[s]->latch);
+      for (std::uint32_t i = 0; i < shards[s]->descs.size(); i++)
+      {
+        unswizzleFrame(i * numShards + s);
+      }
+    }
+  }
+
+  void BufMgr::writerLoop()
+  {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    // rounds start at successive shards, so that a budget too small for all
+    // of them still reaches every shard
+    std::uint32_t firstShard = 0;
+    while (!stopWriter)
+    {
+      writerWake.wait_for(lock,
+                          std::chrono::milliseconds(writerConfig.intervalMs),
+                          [this] { return stopWriter; });
+      if (stopWriter)
+      {
+        break;
+      }
+      lock.unlock();
+      std::uint32_t budget = writerConfig.maxPagesPerRound;
+      for (std::uint32_t n = 0; n < numShards && budget > 0; n++)
+      {
+        budget -= cleanShard((firstShard + n) % numShards, budget);
+      }
+      firstShard = (firstShard + 1) % numShards;
+      lock.lock();
+    }
+  }
+
+  std::uint32_t BufMgr::cleanShard(std::uint32_t shardNo, std::uint32_t budget)
+  {
+    BufShard &shard = *shards[shardNo];
+    std::unique_lock<std::mutex> lock(shard.latch);
+    if (shard.numFrames == 0)
+    {
+      return 0;
+    }
+
+    std::uint32_t start;
+    if (!shard.policy->sweepPosition(start))
+    {
+      start = shard.writerHand;
+    }
+    const std::uint32_t dirtyTarget =
+        std::uint32_t(writerConfig.dirtyRatioTarget * shard.numFrames);
+
+    std::uint32_t written = 0;
+    std::uint32_t step = 0;
+    for (; step < shard.numFrames && written < budget; step++)
+    {
+      if (step >= writerConfig.lookahead && shard.numDirty <= dirtyTarget)
+      {
+        break;
+      }
+      std::uint32_t index = (start + step) % shard.numFrames;
+      BufDesc &desc = descOf(frameOf(shardNo, index));
+      if (!desc.dirty || !desc.evictable())
+      {
+        continue;
+      }
+
+      // Write a copy so the latch can be dropped during the I/O; the writing
+      // flag keeps the frame from being evicted or cleared meanwhile.  Users
+      // may pin and modify the frame during the write, in which case
+      // unPinPage() marks it dirty again.
+      Page copy = bufPool[desc.frameNo];
+      File file = *desc.file;
+      markClean(shardNo, desc.frameNo);
+      desc.writing = true;
+      shard.numUnpinned--;
+
+      lock.unlock();
+      bool ok = true;
+      try
+      {
+        file.writePage(copy);
+      }
+      catch (const BadgerDbException &e)
+      {
+        ok = false;
+      }
+      lock.lock();
+
+      desc.writing = false;
+      if (ok)
+      {
+        bufStats.count(file, BufStat::DISK_WRITES);
+      }
+      else
+      {
+        markDirty(shardNo, desc.frameNo);
+      }
+      if (desc.evictable())
+      {
+        shard.numUnpinned++;
+      }
+      shard.ioDone.notify_all();
+      written++;
+    }
+    shard.writerHand = (start + step) % shard.numFrames;
+    return written;
+  }
+
+  void BufMgr::waitForIo(BufShard &shard, std::unique_lock<std::mutex> &lock,
+                         FrameId frame)
+  {
+    // the frame may be removed by resize() once its I/O completes
+    shard.ioDone.wait(lock, [this, &shard, frame] {
+      return indexOf(frame) >= shard.numFrames ||
+             (!descOf(frame).writing && !descOf(frame).loading);
+    });
+  }
+
+  bool BufMgr::loadPage(std::uint32_t shardNo, std::uint64_t key, File &file,
+                        const PageId pageNo,
+                        std::unique_lock<std::mutex> &lock,
+                        BufAccessStrategy *strategy, FrameId &f)
+  {
+    if (!reserveFrame(shardNo, key, file, pageNo, strategy, f))
+    {
+      return false;
+    }
+
+    // Nobody else touches the frame while it is loading, so the page can be
+    // read straight into it without the latch.
+    lock.unlock();
+    try
+    {
+      file.readPage(pageNo, bufPool[f]);
+    }
+    catch (...)
+    {
+      lock.lock();
+      abortLoad(shardNo, f);
+      throw;
+    }
+    lock.lock();
+    completeLoad(shardNo, key, f);
+    bufStats.count(file, BufStat::DISK_READS);
+    return true;
+  }
+
+  bool BufMgr::reserveFrame(std::uint32_t shardNo, std::uint64_t key,
+                            File &file, const PageId pageNo,
+                            BufAccessStrategy *strategy, FrameId &f)
+  {
+    if (!allocBuf(shardNo, file, key, f, strategy))
+    {
+      bufStats.count(file, BufStat::BUFFER_EXCEEDED);
+      return false;
+    }
+    descOf(f).loading = true;
+    mapFrame(shardNo, f, file, pageNo);
+    descOf(f).ringPage = strategy != NULL;
+    return true;
+  }
+
+  void BufMgr::completeLoad(std::uint32_t shardNo, std::uint64_t key,
+                            FrameId frame)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    desc.loading = false;
+    pageTable.insert(*desc.file, desc.pageNo, frame);
+    shard.policy->recordLoad(indexOf(frame), key);
+    shard.ioDone.notify_all();
+  }
+
+  void BufMgr::abortLoad(std::uint32_t shardNo, FrameId frame)
+  {
+    BufShard &shard = *shards[shardNo];
+    unmapFrame(shardNo, frame);
+    shard.freeFrames.push_back(indexOf(frame));
+    shard.ioDone.notify_all();
+  }
+
+  void BufMgr::pinFrame(std::uint32_t shardNo, FrameId frame,
+                        BufAccessStrategy *strategy)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    desc.refbit = true;
+    if (!strategy)
+    {
+      desc.ringPage = false;
+    }
+    if (desc.evictable())
+    {
+      shard.numUnpinned--;
+    }
+    desc.pinCnt += 1;
+    shard.policy->recordAccess(indexOf(frame));
+  }
+
+  bool BufMgr::unpinFrame(std::uint32_t shardNo, FrameId frame,
+                          const bool dirty)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    if (desc.pinCnt == 0)
+    {
+      return false;
+    }
+    desc.pinCnt -= 1;
+    if (desc.evictable())
+    {
+      shard.numUnpinned++;
+    }
+    if (dirty)
+    {
+      markDirty(shardNo, frame);
+    }
+    return true;
+  }
+
+  void BufMgr::mapFrame(std::uint32_t shardNo, FrameId frame, File &file,
+                        const PageId pageNo)
+  {
+    BufShard &shard = *shards[shardNo];
+    shard.hashTable.insert(file, pageNo, frame);
+    BufShard::FileFrames &entry = shard.fileFrames[file.id()];
+    if (entry.frames.empty())
+    {
+      entry.file = file;
+    }
+    entry.frames.insert(indexOf(frame));
+    BufDesc &desc = descOf(frame);
+    desc.Set(&entry.file, pageNo);
+    if (!desc.loading)
+    {
+      pageTable.insert(file, pageNo, frame);
+    }
+  }
+
+  void BufMgr::unmapFrame(std::uint32_t shardNo, FrameId frame)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    markClean(shardNo, frame);
+    shard.hashTable.remove(*desc.file, desc.pageNo);
+    pageTable.remove(*desc.file, desc.pageNo);
+    auto it = shard.fileFrames.find(desc.fileId);
+    it->second.frames.erase(indexOf(frame));
+    if (it->second.frames.empty())
+    {
+      shard.fileFrames.erase(it);
+    }
+    unswizzleFrame(frame);
+    desc.clear();
+    // invalidate optimistic references before the frame is reused; a
+    // reader that sees the new version no longer finds the page in pageTable
+    bufPool.version(frame).fetch_add(2, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void BufMgr::swizzle(FrameId frame, SwizzledPageRef &ref)
+  {
+    if (ref.frame_.load(std::memory_order_relaxed) !=
+        SwizzledPageRef::NOT_SWIZZLED)
+    {
+      return;
+    }
+    descOf(frame).swizzledRefs.push_back(&ref);
+    ref.mgr_.store(this, std::memory_order_relaxed);
+    ref.frame_.store(frame, std::memory_order_release);
+  }
+
+  void BufMgr::unswizzleFrame(FrameId frame)
+  {
+    BufDesc &desc = descOf(frame);
+    for (SwizzledPageRef *ref : desc.swizzledRefs)
+    {
+      ref->mgr_.store(NULL, std::memory_order_relaxed);
+      ref->frame_.store(SwizzledPageRef::NOT_SWIZZLED,
+                        std::memory_order_release);
+    }
+    desc.swizzledRefs.clear();
+  }
+
+  void BufMgr::unswizzle(SwizzledPageRef &ref)
+  {
+    while (true)
+    {
+      FrameId f = ref.frame_.load(std::memory_order_acquire);
+      if (f == SwizzledPageRef::NOT_SWIZZLED)
+      {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(shards[f % numShards]->latch);
+      // the page may have left the frame before the latch was taken
+      if (ref.frame_.load(std::memory_order_relaxed) == f)
+      {
+        std::vector<SwizzledPageRef *> &refs = descOf(f).swizzledRefs;
+        refs.erase(std::find(refs.begin(), refs.end(), &ref));
+        ref.mgr_.store(NULL, std::memory_order_relaxed);
+        ref.frame_.store(SwizzledPageRef::NOT_SWIZZLED,
+                         std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  void BufMgr::markDirty(std::uint32_t shardNo, FrameId frame)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    if (!desc.dirty)
+    {
+      desc.dirty = true;
+      shard.numDirty++;
+      shard.fileFrames[desc.fileId].dirty.insert(indexOf(frame));
+    }
+  }
+
+  void BufMgr::markClean(std::uint32_t shardNo, FrameId frame)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frame);
+    if (desc.dirty)
+    {
+      desc.dirty = false;
+      shard.numDirty--;
+      shard.fileFrames[desc.fileId].dirty.erase(indexOf(frame));
+    }
+  }
+
+  std::uint64_t BufMgr::pageKey(const File &file, const PageId pageNo)
+  {
+    // Mix the bits so the shard index is independent of the bucket index the
+    // shard's hash table derives from the same inputs.
+    std::uint64_t h =
+        ((std::uint64_t(file.id()) << 32) | pageNo) * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  void BufMgr::evictFrame(std::uint32_t shardNo, std::uint32_t index)
+  {
+    BufShard &shard = *shards[shardNo];
+    BufDesc &desc = descOf(frameOf(shardNo, index));
+    if (desc.dirty)
+    {
+      desc.file->writePage(bufPool[desc.frameNo]);
+      bufStats.count(*desc.file, BufStat::WRITE_BACKS);
+      bufStats.count(*desc.file, BufStat::DISK_WRITES);
+    }
+    bufStats.count(*desc.file, BufStat::EVICTIONS);
+    unmapFrame(shardNo, desc.frameNo);
+    shard.numUnpinned--;
+  }
+
+  bool BufMgr::allocBuf(std::uint32_t shardNo, const File &file,
+                        std::uint64_t key, FrameId &frame,
+                        BufAccessStrategy *strategy)
+  {
+    BufShard &shard = *shards[shardNo];
+    if (strategy)
+    {
+      std::vector<FrameId> &ring = strategy->rings[shardNo];
+      std::uint32_t &cursor = strategy->cursors[shardNo];
+      // the limit follows the shard's size, which resize() may change
+      const std::uint32_t ringSize = std::max(
+          1u, std::min(strategy->frames / numShards, shard.numFrames / 8));
+      if (ring.size() > ringSize)
+      {
+        ring.resize(ringSize);
+        cursor %= ringSize;
+      }
+      if (ring.size() >= ringSize &&
+          indexOf(ring[cursor]) < shard.numFrames)
+      {
+        const BufDesc &desc = descOf(ring[cursor]);
+        if (desc.ringPage && desc.evictable())
+        {
+          // recycle the ring's own frame
+          evictFrame(shardNo, indexOf(ring[cursor]));
+          shard.policy->recordRemove(indexOf(ring[cursor]));
+          frame = ring[cursor];
+          cursor = (cursor + 1) % ring.size();
+          return true;
+        }
+      }
+      // allocate normally and make the frame part of the ring
+      if (!allocBuf(shardNo, file, key, frame))
+      {
+        return false;
+      }
+      if (ring.size() < ringSize)
+      {
+        ring.push_back(frame);
+      }
+      else
+      {
+        ring[cursor] = frame;
+        cursor = (cursor + 1) % ring.size();
+      }
+      return true;
+    }
+
+    if (!shard.freeFrames.empty())
+    {
+      frame = frameOf(shardNo, shard.freeFrames.back());
+      shard.freeFrames.pop_back();
+      return true;
+    }
+    if (shard.numUnpinned == 0)
+    {
+      return false;
+    }
+
+    FrameId index;
+    const std::uint64_t steps = shard.policy->sweepSteps();
+    bool found = shard.policy->pickVictim(
+        key,
+        [this, shardNo](FrameId i) {
+          return descOf(frameOf(shardNo, i)).evictable();
+        },
+        index);
+    bufStats.count(file, BufStat::VICTIM_SEARCHES);
+    bufStats.count(file, BufStat::SWEEP_STEPS,
+                   shard.policy->sweepSteps() - steps);
+    if (!found)
+    {
+      return false;
+    }
+
+    try
+    {
+      evictFrame(shardNo, index);
+    }
+    catch (...)
+    {
+      // The page stays resident, so hand it back to the policy.
+      const BufDesc &desc = descOf(frameOf(shardNo, index));
+      shard.policy->recordLoad(index, pageKey(*desc.file, desc.pageNo));
+      throw;
+    }
+    frame = frameOf(shardNo, index);
+    return true;
+  }
+
+  std::shared_ptr<BufAccessStrategy> BufMgr::detectScan(const File &file,
+                                                        const PageId pageNo)
+  {
+    std::lock_guard<std::mutex> lock(scanMutex);
+    if (scanThreshold == 0)
+    {
+      return std::shared_ptr<BufAccessStrategy>();
+    }
+    ScanState &scan = scans[file.id()];
+    // Pages of a scan that are already resident do not miss, so allow small
+    // forward gaps.
+    if (scan.run > 0 && pageNo > scan.lastPage && pageNo - scan.lastPage <= 8)
+    {
+      scan.run++;
+    }
+    else
+    {
+      scan.run = 1;
+    }
+    scan.lastPage = pageNo;
+    if (scan.run < scanThreshold)
+    {
+      return std::shared_ptr<BufAccessStrategy>();
+    }
+    if (!scan.strategy)
+    {
+      scan.strategy = std::make_shared<BufAccessStrategy>(*this, scanRingFrames);
+    }
+    return scan.strategy;
+  }
+
+  void BufMgr::setScanDetection(std::uint32_t threshold,
+                                std::uint32_t ringFrames)
+  {
+    std::lock_guard<std::mutex> lock(scanMutex);
+    scanThreshold = threshold;
+    scanRingFrames = ringFrames;
+    scans.clear();
+  }
+
+  std::vector<MissRatioPoint> BufMgr::getMissRatioCurve() const
+  {
+    // multiples of the pool size, in halves
+    static const std::uint32_t HALVES[] = {1, 2, 3, 4, 6, 8};
+    std::vector<MissRatioPoint> curve;
+    for (std::uint32_t halves : HALVES)
+    {
+      const std::uint32_t frames =
+          std::max<std::uint64_t>(1, std::uint64_t(numBufs) * halves / 2);
+      curve.push_back(MissRatioPoint{frames, missRatio.hitRatio(frames)});
+    }
+    return curve;
+  }
+
+  void BufMgr::startTrace(const std::string &path)
+  {
+    std::shared_ptr<BufTraceWriter> replaced = std::atomic_exchange(
+        &tracer, std::make_shared<BufTraceWriter>(path));
+    tracing = true;
+    if (replaced)
+    {
+      replaced->close();
+    }
+  }
+
+  void BufMgr::stopTrace()
+  {
+    // calls that are still recording an event keep the writer alive, but
+    // what they record once it is closed is dropped
+    tracing = false;
+    std::shared_ptr<BufTraceWriter> writer =
+        std::atomic_exchange(&tracer, std::shared_ptr<BufTraceWriter>());
+    if (writer)
+    {
+      writer->close();
+    }
+  }
+
+  void BufMgr::trace(BufTraceOp op, const File &file, PageId pageNo,
+                     bool dirty)
+  {
+    if (!tracing.load(std::memory_order_relaxed))
+    {
+      return;
+    }
+    std::shared_ptr<BufTraceWriter> writer = std::atomic_load(&tracer);
+    if (writer)
+    {
+      writer->record(op, file.filename(), pageNo, dirty);
+    }
+  }
+
+  void BufMgr::readPage(File &file, const PageId pageNo, Page *&page,
+                        BufAccessStrategy *strategy)
+  {
+    trace(BufTraceOp::READ, file, pageNo);
+    if (fetchPage(file, pageNo, page, strategy) != BufResult::OK)
+    {
+      throw BufferExceededException();
+    }
+  }
+
+  BufResult BufMgr::tryReadPage(File &file, const PageId pageNo, Page *&page,
+                                BufAccessStrategy *strategy)
+  {
+    trace(BufTraceOp::READ, file, pageNo);
+    return fetchPage(file, pageNo, page, strategy);
+  }
+
+  void BufMgr::readPage(SwizzledPageRef &ref, Page *&page,
+                        BufAccessStrategy *strategy)
+  {
+    trace(BufTraceOp::READ, ref.file_, ref.page_no_);
+    FrameId f = ref.frame_.load(std::memory_order_acquire);
+    if (f != SwizzledPageRef::NOT_SWIZZLED &&
+        ref.mgr_.load(std::memory_order_relaxed) == this)
+    {
+      std::uint32_t shardNo = f % numShards;
+      bool hit = false;
+      {
+        std::lock_guard<std::mutex> lock(shards[shardNo]->latch);
+        // swizzled references change only under the latch of their frame
+        if (ref.frame_.load(std::memory_order_relaxed) == f &&
+            ref.mgr_.load(std::memory_order_relaxed) == this)
+        {
+          bufStats.count(ref.file_, BufStat::ACCESSES);
+          bufStats.count(ref.file_, BufStat::HITS);
+          pinFrame(shardNo, f, strategy);
+          page = &bufPool[f];
+          hit = true;
+        }
+      }
+      if (hit)
+      {
+        missRatio.access(ref.key_);
+        return;
+      }
+    }
+
+    if (fetchPage(ref.file_, ref.page_no_, page, strategy) != BufResult::OK)
+    {
+      throw BufferExceededException();
+    }
+    // the page is pinned, so it stays in its frame until the latch is taken
+    std::lock_guard<std::mutex> lock(shards[shardOf(ref.key_)]->latch);
+    swizzle(bufPool.frameOf(page), ref);
+  }
+
+  BufResult BufMgr::fetchPage(File &file, const PageId pageNo, Page *&page,
+                              BufAccessStrategy *strategy, bool batched)
+  {
+    std::uint64_t key = pageKey(file, pageNo);
+    if (!batched)
+    {
+      missRatio.access(key);
+    }
+    std::uint32_t shardNo = shardOf(key);
+    BufShard &shard = *shards[shardNo];
+    std::unique_lock<std::mutex> lock(shard.latch);
+    bufStats.count(file, BufStat::ACCESSES);
+
+    // check if the page is already in the buffer pool via lookup method
+    FrameId f;
+
+    while (true)
+    {
+      if (!shard.hashTable.tryLookup(file, pageNo, f))
+      {
+        // page is not in the buffer pool:
+        bufStats.count(file, BufStat::MISSES);
+        std::shared_ptr<BufAccessStrategy> detected;
+        if (!strategy && !batched)
+        {
+          detected = detectScan(file, pageNo);
+        }
+        if (!loadPage(shardNo, key, file, pageNo, lock,
+                      strategy ? strategy : detected.get(), f))
+        {
+          return BufResult::BUFFER_EXCEEDED;
+        }
+        break;
+      }
+      if (!descOf(f).loading)
+      {
+        // page is in the buffer pool:
+        bufStats.count(file, BufStat::HITS);
+        pinFrame(shardNo, f, strategy);
+        break;
+      }
+      // page is being read in; wait for that read and look again, since it
+      // may have failed
+      waitForIo(shard, lock, f);
+    }
+    page = &bufPool[f];
+    return BufResult::OK;
+  }
+
+  void BufMgr::readPages(File &file, const std::vector<PageId> &pageIds,
+                         std::vector<Page *> &pages,
+                         BufAccessStrategy *strategy)
+  {
+    for (PageId pageNo : pageIds)
+    {
+      trace(BufTraceOp::READ, file, pageNo);
+    }
+    pages.assign(pageIds.size(), NULL);
+    std::vector<std::uint64_t> keys(pageIds.size());
+    std::vector<FrameId> frames(pageIds.size());
+    std::vector<std::vector<std::size_t>> byShard(numShards);
+    for (std::size_t i = 0; i < pageIds.size(); i++)
+    {
+      keys[i] = pageKey(file, pageIds[i]);
+      missRatio.access(keys[i]);
+      byShard[shardOf(keys[i])].push_back(i);
+    }
+
+    // Positions in pageIds that this call reserved a frame for, that are left
+    // to fetchPage() because the page is loading (possibly a duplicate of a
+    // reserved page), and that are pinned
+    std::vector<std::size_t> misses, retries, pinned;
+    std::exception_ptr error;
+
+    // pin the hits and reserve frames for the misses, one latch per shard
+    for (std::uint32_t s = 0; s < numShards && !error; s++)
+    {
+      if (byShard[s].empty())
+      {
+        continue;
+      }
+      BufShard &shard = *shards[s];
+      std::lock_guard<std::mutex> lock(shard.latch);
+      for (std::size_t i : byShard[s])
+      {
+        FrameId f;
+        if (!shard.hashTable.tryLookup(file, pageIds[i], f))
+        {
+          try
+          {
+            if (!reserveFrame(s, keys[i], file, pageIds[i], strategy,
+                              frames[i]))
+            {
+              throw BufferExceededException();
+            }
+          }
+          catch (...)
+          {
+            error = std::current_exception();
+            break;
+          }
+          misses.push_back(i);
+          continue;
+        }
+        if (descOf(f).loading)
+        {
+          retries.push_back(i);
+        }
+        else
+        {
+          pinFrame(s, f, strategy);
+          pages[i] = &bufPool[f];
+          pinned.push_back(i);
+        }
+      }
+    }
+
+    // the pages left to fetchPage() are counted there
+    bufStats.count(file, BufStat::ACCESSES, pinned.size() + misses.size());
+    bufStats.count(file, BufStat::HITS, pinned.size());
+    bufStats.count(file, BufStat::MISSES, misses.size());
+
+    // read the reserved pages without any latch, all at once, submitted in
+    // page number order
+    std::sort(misses.begin(), misses.end(),
+              [&pageIds](std::size_t a, std::size_t b) {
+                return pageIds[a] < pageIds[b];
+              });
+    std::vector<std::exception_ptr> readErrors;
+    if (!error && !misses.empty())
+    {
+      std::vector<PageId> missIds;
+      std::vector<Page *> dests;
+      for (std::size_t i : misses)
+      {
+        missIds.push_back(pageIds[i]);
+        dests.push_back(&bufPool[frames[i]]);
+      }
+      try
+      {
+        file.readPages(ioEngine(), missIds, dests, readErrors);
+      }
+      catch (...)
+      {
+        readErrors.assign(misses.size(), std::current_exception());
+      }
+      std::size_t loaded = 0;
+      for (const std::exception_ptr &e : readErrors)
+      {
+        if (!e)
+        {
+          loaded++;
+        }
+        else if (!error)
+        {
+          error = e;
+        }
+      }
+      bufStats.count(file, BufStat::DISK_READS, loaded);
+    }
+
+    // publish the pages that were read and release the other reserved frames
+    std::vector<std::vector<std::size_t>> missesByShard(numShards);
+    for (std::size_t m = 0; m < misses.size(); m++)
+    {
+      missesByShard[shardOf(keys[misses[m]])].push_back(m);
+    }
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      if (missesByShard[s].empty())
+      {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(shards[s]->latch);
+      for (std::size_t m : missesByShard[s])
+      {
+        std::size_t i = misses[m];
+        if (m < readErrors.size() && !readErrors[m])
+        {
+          completeLoad(s, keys[i], frames[i]);
+          pages[i] = &bufPool[frames[i]];
+          pinned.push_back(i);
+        }
+        else
+        {
+          abortLoad(s, frames[i]);
+        }
+      }
+    }
+
+    for (std::size_t r = 0; r < retries.size() && !error; r++)
     {
-      bufDescTable[i].frameNo = i;
-      bufDescTable[i].valid = false;
+      std::size_t i = retries[r];
+      try
+      {
+        if (fetchPage(file, pageIds[i], pages[i], strategy,
+                      true /* batched */) != BufResult::OK)
+        {
+          throw BufferExceededException();
+        }
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+        break;
+      }
+      pinned.push_back(i);
     }
 
-    clockHand = bufs - 1;
+    if (error)
+    {
+      // the caller never sees these pins, so their release is not traced
+      for (std::size_t i : pinned)
+      {
+        FrameId fid;
+        releasePage(file, pageIds[i], false, fid);
+      }
+      pages.assign(pageIds.size(), NULL);
+      std::rethrow_exception(error);
+    }
   }
 
-  void BufMgr::advanceClock()
+  void BufMgr::prefetch(File &file, const std::vector<PageId> &pageIds)
   {
-    if (clockHand + 1 >= numBufs)
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    if (stopPrefetch)
     {
-      clockHand = 0;
+      return;
     }
-    else
+    for (PageId pageNo : pageIds)
+    {
+      prefetchQueue.push_back(PrefetchRequest{file, pageNo});
+    }
+    if (!prefetcher.joinable())
+    {
+      prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+    }
+    prefetchWake.notify_one();
+  }
+
+  void BufMgr::prefetchRange(File &file, const PageId first,
+                             std::uint32_t count)
+  {
+    std::vector<PageId> pageIds;
+    for (std::uint32_t i = 0; i < count; i++)
     {
-      clockHand++;
+      pageIds.push_back(first + i);
     }
+    prefetch(file, pageIds);
   }
 
-  void BufMgr::allocBuf(FrameId &frame)
+  void BufMgr::prefetchLoop()
   {
-    advanceClock();
-    bool allocated = false;
-    std::vector<bool> pinned(numBufs, false);
-    uint32_t numPinned = 0;
-    while (!allocated)
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    while (true)
     {
-      if (numPinned >= numBufs)
+      prefetchWake.wait(lock, [this] {
+        return stopPrefetch || !prefetchQueue.empty();
+      });
+      if (stopPrefetch)
       {
-        throw BufferExceededException();
+        break;
       }
-      if (bufDescTable[clockHand].valid) {
-        if (bufDescTable[clockHand].refbit)
-        {
-          bufDescTable[clockHand].refbit = false;
-          advanceClock();
-          continue;
-        }
-        else if (bufDescTable[clockHand].pinCnt > 0)
+      // take the pages queued next for the same file, to read them at once
+      File file = prefetchQueue.front().file;
+      std::vector<PageId> pageIds;
+      while (!prefetchQueue.empty() && prefetchQueue.front().file == file &&
+             pageIds.size() < PREFETCH_BATCH)
+      {
+        pageIds.push_back(prefetchQueue.front().pageNo);
+        prefetchQueue.pop_front();
+      }
+      lock.unlock();
+      prefetchPages(file, pageIds);
+      lock.lock();
+    }
+  }
+
+  IoEngine &BufMgr::ioEngine()
+  {
+    std::call_once(ioOnce, [this] { io = IoEngine::create(); });
+    return *io;
+  }
+
+  void BufMgr::prefetchPages(File &file, const std::vector<PageId> &pageIds)
+  {
+    // reserve frames for the pages that are not in the pool
+    struct Load
+    {
+      std::uint32_t shard;
+      std::uint64_t key;
+      FrameId frame;
+    };
+    std::vector<Load> loads;
+    std::vector<PageId> loadIds;
+    std::vector<Page *> dests;
+    for (PageId pageNo : pageIds)
+    {
+      std::uint64_t key = pageKey(file, pageNo);
+      std::uint32_t shardNo = shardOf(key);
+      std::lock_guard<std::mutex> lock(shards[shardNo]->latch);
+      FrameId f;
+      if (shards[shardNo]->hashTable.tryLookup(file, pageNo, f))
+      {
+        continue;
+      }
+      try
+      {
+        if (!reserveFrame(shardNo, key, file, pageNo, NULL, f))
         {
-          if (!pinned[clockHand]) {
-            pinned[clockHand] = true;
-            numPinned++;
-          }
-          advanceClock();
           continue;
         }
-        else if (bufDescTable[clockHand].dirty)
-        {
-          bufDescTable[clockHand].file.writePage(bufPool[clockHand]);
-        }
-        hashTable.remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-      } 
-        frame = bufDescTable[clockHand].frameNo;
-        allocated = true;
+      }
+      catch (const BadgerDbException &e)
+      {
+        continue;
+      }
+      loads.push_back(Load{shardNo, key, f});
+      loadIds.push_back(pageNo);
+      dests.push_back(&bufPool[f]);
+    }
+    if (loads.empty())
+    {
+      return;
+    }
+
+    std::vector<std::exception_ptr> errors;
+    try
+    {
+      file.readPages(ioEngine(), loadIds, dests, errors);
     }
+    catch (...)
+    {
+      errors.assign(loads.size(), std::current_exception());
+    }
+
+    std::size_t loaded = 0;
+    for (std::size_t k = 0; k < loads.size(); k++)
+    {
+      const Load &l = loads[k];
+      BufShard &shard = *shards[l.shard];
+      std::lock_guard<std::mutex> lock(shard.latch);
+      if (errors[k])
+      {
+        abortLoad(l.shard, l.frame);
+        continue;
+      }
+      completeLoad(l.shard, l.key, l.frame);
+      loaded++;
+      // nobody asked for the page yet, so leave it unpinned
+      descOf(l.frame).pinCnt -= 1;
+      if (descOf(l.frame).evictable())
+      {
+        shard.numUnpinned++;
+      }
+    }
+    bufStats.count(file, BufStat::DISK_READS, loaded);
   }
 
-  
-  void BufMgr::readPage(File &file, const PageId pageNo, Page *&page)
+  bool BufMgr::optimisticRef(File &file, const PageId pageNo,
+                             OptimisticRef &ref)
   {
-    // check if the page is already in the buffer pool via lookup method
+    // A frame found in pageTable held the page when its version was read if
+    // it still holds it afterwards, since unmapFrame() removes the page
+    // before it changes the version.
     FrameId f;
-
-    try
+    FrameId again;
+    if (pageTable.lookup(file, pageNo, f))
     {
-      hashTable.lookup(file, pageNo, f);
-      // page is in the buffer pool:
-      bufDescTable[f].refbit = true;
-      bufDescTable[f].pinCnt += 1;
-      page = &bufPool[f];
+      std::uint64_t version =
+          bufPool.version(f).load(std::memory_order_acquire);
+      if ((version & 1) == 0 && pageTable.lookup(file, pageNo, again) &&
+          again == f)
+      {
+        ref.frame = f;
+        ref.version = version;
+        return true;
+      }
     }
-    catch (const HashNotFoundException &e)
+
+    // the page is being read in, written, or not in the pool
+    std::uint32_t shardNo = shardOf(pageKey(file, pageNo));
+    BufShard &shard = *shards[shardNo];
+    std::unique_lock<std::mutex> lock(shard.latch);
+
+    while (shard.hashTable.tryLookup(file, pageNo, f))
     {
-      // page is not in the buffer pool:
-      Page p = file.readPage(pageNo);
-      allocBuf(f);
-      bufPool[f] = p;
-      hashTable.insert(file, pageNo, f);
-      bufDescTable[f].Set(file, pageNo);
-      page = &bufPool[f];
+      if (!descOf(f).loading)
+      {
+        ref.frame = f;
+        ref.version = bufPool.version(f).load(std::memory_order_acquire);
+        return (ref.version & 1) == 0;
+      }
+      waitForIo(shard, lock, f);
     }
+    return false;
   }
 
   void BufMgr::unPinPage(File &file, const PageId pageNo, const bool dirty)
   {
+    trace(BufTraceOp::UNPIN, file, pageNo, dirty);
+    FrameId fid = 0;
+    BufResult result = releasePage(file, pageNo, dirty, fid);
+    if (result == BufResult::PAGE_NOT_RESIDENT)
+    {
+      std::cerr << HashNotFoundException(file.filename(), pageNo).message();
+    }
+    else if (result == BufResult::PAGE_NOT_PINNED)
+    {
+      throw PageNotPinnedException(file.filename(), pageNo, fid);
+    }
+  }
+
+  void BufMgr::unPinPage(SwizzledPageRef &ref, const bool dirty)
+  {
+    trace(BufTraceOp::UNPIN, ref.file_, ref.page_no_, dirty);
+    FrameId fid = ref.frame_.load(std::memory_order_acquire);
+    BufResult result = BufResult::PAGE_NOT_RESIDENT;
+    if (fid != SwizzledPageRef::NOT_SWIZZLED &&
+        ref.mgr_.load(std::memory_order_relaxed) == this)
+    {
+      std::uint32_t shardNo = fid % numShards;
+      std::lock_guard<std::mutex> lock(shards[shardNo]->latch);
+      if (ref.frame_.load(std::memory_order_relaxed) == fid &&
+          ref.mgr_.load(std::memory_order_relaxed) == this)
+      {
+        result = unpinFrame(shardNo, fid, dirty) ? BufResult::OK
+                                                 : BufResult::PAGE_NOT_PINNED;
+      }
+    }
+    if (result == BufResult::PAGE_NOT_RESIDENT)
+    {
+      result = releasePage(ref.file_, ref.page_no_, dirty, fid);
+    }
+
+    if (result == BufResult::PAGE_NOT_RESIDENT)
+    {
+      std::cerr << HashNotFoundException(ref.file_.filename(), ref.page_no_)
+                       .message();
+    }
+    else if (result == BufResult::PAGE_NOT_PINNED)
+    {
+      throw PageNotPinnedException(ref.file_.filename(), ref.page_no_, fid);
+    }
+  }
+
+  BufResult BufMgr::tryUnPinPage(File &file, const PageId pageNo,
+                                 const bool dirty)
+  {
+    trace(BufTraceOp::UNPIN, file, pageNo, dirty);
     FrameId fid;
-    try
+    return releasePage(file, pageNo, dirty, fid);
+  }
+
+  BufResult BufMgr::releasePage(File &file, const PageId pageNo,
+                                const bool dirty, FrameId &fid)
+  {
+    std::uint32_t shardNo = shardOf(pageKey(file, pageNo));
+    BufShard &shard = *shards[shardNo];
+    std::lock_guard<std::mutex> lock(shard.latch);
+
+    if (!shard.hashTable.tryLookup(file, pageNo, fid))
     {
-      hashTable.lookup(file, pageNo, fid);
+      return BufResult::PAGE_NOT_RESIDENT;
     }
-    catch (const HashNotFoundException &e)
+    if (!unpinFrame(shardNo, fid, dirty))
     {
-      std::cerr << e.message();
-      return;
+      return BufResult::PAGE_NOT_PINNED;
+    }
+    return BufResult::OK;
+  }
+
+  void BufMgr::unPinPages(File &file, const std::vector<PageId> &pageIds,
+                          const bool dirty)
+  {
+    std::vector<std::vector<PageId>> byShard(numShards);
+    for (PageId pageNo : pageIds)
+    {
+      trace(BufTraceOp::UNPIN, file, pageNo, dirty);
+      byShard[shardOf(pageKey(file, pageNo))].push_back(pageNo);
     }
-    if (bufDescTable[fid].pinCnt > 0)
+
+    bool notPinned = false;
+    PageId badPage = 0;
+    FrameId badFrame = 0;
+    for (std::uint32_t s = 0; s < numShards; s++)
     {
-      bufDescTable[fid].pinCnt -= 1;
-      if (dirty)
+      if (byShard[s].empty())
       {
-        bufDescTable[fid].dirty = true;
+        continue;
+      }
+      BufShard &shard = *shards[s];
+      std::lock_guard<std::mutex> lock(shard.latch);
+      for (PageId pageNo : byShard[s])
+      {
+        FrameId fid;
+        if (!shard.hashTable.tryLookup(file, pageNo, fid))
+        {
+          std::cerr
+              << HashNotFoundException(file.filename(), pageNo).message();
+          continue;
+        }
+        if (!unpinFrame(s, fid, dirty) && !notPinned)
+        {
+          notPinned = true;
+          badPage = pageNo;
+          badFrame = fid;
+        }
       }
     }
-    else
+    if (notPinned)
     {
-      throw PageNotPinnedException(file.filename(), pageNo, fid);
+      throw PageNotPinnedException(file.filename(), badPage, badFrame);
     }
   }
 
   void BufMgr::allocPage(File &file, PageId &pageNo, Page* &page)
   {
+    if (tryAllocPage(file, pageNo, page) != BufResult::OK)
+    {
+      throw BufferExceededException();
+    }
+  }
+
+  BufResult BufMgr::tryAllocPage(File &file, PageId &pageNo, Page *&page)
+  {
+    // The page number, and therefore the shard, is only known once the page
+    // has been allocated in the file.  A new page is empty, so the file only
+    // hands out its header and the page is laid out in the frame.
+    const PageHeader header = file.allocatePageHeader();
+    pageNo = header.current_page_number;
+    bufStats.count(file, BufStat::ACCESSES);
+    bufStats.count(file, BufStat::ALLOCS);
+
+    std::uint64_t key = pageKey(file, pageNo);
+    missRatio.access(key);
+    std::uint32_t shardNo = shardOf(key);
+    BufShard &shard = *shards[shardNo];
+    std::lock_guard<std::mutex> lock(shard.latch);
+
     FrameId fid;
-    allocBuf(fid);
-    bufPool[fid] = file.allocatePage();
+    if (!allocBuf(shardNo, file, key, fid))
+    {
+      bufStats.count(file, BufStat::BUFFER_EXCEEDED);
+      // Do not leave behind a page that the caller never got to see.
+      file.deletePage(pageNo);
+      return BufResult::BUFFER_EXCEEDED;
+    }
+    bufPool[fid].initialize(header);
     page = &bufPool[fid];
-    pageNo = bufPool[fid].page_number();
-    hashTable.insert(file, pageNo, fid);
-    bufDescTable[fid].Set(file, pageNo);
+    mapFrame(shardNo, fid, file, pageNo);
+    shard.policy->recordLoad(indexOf(fid), key);
+    trace(BufTraceOp::ALLOC, file, pageNo);
+    return BufResult::OK;
+  }
+
+  void BufMgr::checkpointFile(File &file)
+  {
+    // collect the file's dirty pages from every shard, so that runs of
+    // consecutive pages are found even though the shards split them up
+    struct DirtyPage
+    {
+      PageId pageNo;
+      std::uint32_t shard;
+      FrameId frame;
+    };
+    std::vector<DirtyPage> dirtyPages;
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      BufShard &shard = *shards[s];
+      std::lock_guard<std::mutex> lock(shard.latch);
+      auto it = shard.fileFrames.find(file.id());
+      if (it == shard.fileFrames.end())
+      {
+        continue;
+      }
+      for (std::uint32_t j : it->second.dirty)
+      {
+        FrameId f = frameOf(s, j);
+        dirtyPages.push_back(DirtyPage{descOf(f).pageNo, s, f});
+      }
+    }
+    std::sort(dirtyPages.begin(), dirtyPages.end(),
+              [](const DirtyPage &a, const DirtyPage &b) {
+                return a.pageNo < b.pageNo;
+              });
+
+    for (std::size_t first = 0; first < dirtyPages.size();
+         first += CHECKPOINT_BATCH)
+    {
+      const std::size_t last =
+          std::min(dirtyPages.size(), first + CHECKPOINT_BATCH);
+
+      // Copy the pages that are still dirty and unpinned, like the background
+      // writer, and hold them in the writing state until they are on disk.
+      std::vector<Page> copies;
+      std::vector<const DirtyPage *> taken;
+      copies.reserve(last - first);
+      for (std::size_t k = first; k < last; k++)
+      {
+        const DirtyPage &d = dirtyPages[k];
+        BufShard &shard = *shards[d.shard];
+        std::lock_guard<std::mutex> lock(shard.latch);
+        if (indexOf(d.frame) >= shard.numFrames)
+        {
+          continue;
+        }
+        BufDesc &desc = descOf(d.frame);
+        if (desc.fileId != file.id() || desc.pageNo != d.pageNo || !desc.dirty ||
+            !desc.evictable())
+        {
+          continue;
+        }
+        copies.push_back(bufPool[d.frame]);
+        taken.push_back(&d);
+        markClean(d.shard, d.frame);
+        desc.writing = true;
+        shard.numUnpinned--;
+      }
+
+      std::vector<const Page *> pages;
+      for (const Page &copy : copies)
+      {
+        pages.push_back(&copy);
+      }
+      std::exception_ptr error;
+      try
+      {
+        file.writePages(ioEngine(), pages);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+      if (!error)
+      {
+        bufStats.count(file, BufStat::DISK_WRITES, taken.size());
+      }
+
+      for (const DirtyPage *d : taken)
+      {
+        BufShard &shard = *shards[d->shard];
+        std::lock_guard<std::mutex> lock(shard.latch);
+        BufDesc &desc = descOf(d->frame);
+        desc.writing = false;
+        if (error)
+        {
+          markDirty(d->shard, d->frame);
+        }
+        if (desc.evictable())
+        {
+          shard.numUnpinned++;
+        }
+        shard.ioDone.notify_all();
+      }
+      if (error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
   }
 
   void BufMgr::flushFile(File &file)
   {
-    for (FrameId i = 0; i < numBufs; i++) {
-      if (bufDescTable[i].file==file) {
-        if (!bufDescTable[i].valid) {
-          throw BadBufferException(i, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
+    trace(BufTraceOp::FLUSH, file, 0);
+    {
+      std::lock_guard<std::mutex> lock(scanMutex);
+      scans.erase(file.id());
+    }
+
+    // Write the dirty pages in bulk first; the loop below only has to write
+    // pages that were dirtied or pinned meanwhile.
+    checkpointFile(file);
+
+    for (std::uint32_t s = 0; s < numShards; s++) {
+      BufShard &shard = *shards[s];
+      std::unique_lock<std::mutex> lock(shard.latch);
+
+      // Wait until none of the file's frames is under I/O.  The set of frames
+      // may change while waiting, so look it up again every time.
+      auto it = shard.fileFrames.find(file.id());
+      while (it != shard.fileFrames.end()) {
+        FrameId busy = 0;
+        bool anyBusy = false;
+        for (std::uint32_t j : it->second.frames) {
+          const BufDesc &desc = descOf(frameOf(s, j));
+          if (desc.writing || desc.loading) {
+            busy = desc.frameNo;
+            anyBusy = true;
+            break;
+          }
+        }
+        if (!anyBusy) {
+          break;
+        }
+        waitForIo(shard, lock, busy);
+        it = shard.fileFrames.find(file.id());
+      }
+      if (it == shard.fileFrames.end()) {
+        continue;
+      }
+
+      for (std::uint32_t j : it->second.frames) {
+        FrameId i = frameOf(s, j);
+        if (!descOf(i).valid) {
+          throw BadBufferException(i, descOf(i).dirty, descOf(i).valid, descOf(i).refbit);
         }
-        if (bufDescTable[i].pinCnt > 0) {
-          throw PagePinnedException(file.filename(), bufDescTable[i].pageNo, i);
+        if (descOf(i).pinCnt > 0) {
+          throw PagePinnedException(file.filename(), descOf(i).pageNo, i);
         }
-        if (bufDescTable[i].dirty) {
+      }
+
+      // unmapping the last frame erases the file's entry
+      std::vector<std::uint32_t> frames(it->second.frames.begin(),
+                                        it->second.frames.end());
+      for (std::uint32_t j : frames) {
+        FrameId i = frameOf(s, j);
+        if (descOf(i).dirty) {
           file.writePage(bufPool[i]);
-          bufDescTable[i].dirty = false;
+          bufStats.count(file, BufStat::DISK_WRITES);
         }
-        hashTable.remove(file, bufDescTable[i].pageNo);
-        bufDescTable[i].clear();
+        unmapFrame(s, i);
+        shard.policy->recordRemove(j);
+        shard.freeFrames.push_back(j);
+        shard.numUnpinned--;
       }
     }
   }
 
   void BufMgr::disposePage(File &file, const PageId PageNo)
   {
-    
-    FrameId fid;
-    bool frameAllocated = true;
+    trace(BufTraceOp::DISPOSE, file, PageNo);
+    {
+      std::uint32_t shardNo = shardOf(pageKey(file, PageNo));
+      BufShard &shard = *shards[shardNo];
+      std::unique_lock<std::mutex> lock(shard.latch);
+
+      FrameId fid;
+      bool frameAllocated = true;
+      do
+      {
+        if (!shard.hashTable.tryLookup(file, PageNo, fid))
+        {
+          frameAllocated = false;
+          break;
+        }
+        if (!descOf(fid).writing && !descOf(fid).loading)
+        {
+          break;
+        }
+        // the page may be evicted or fail to load once the I/O completes, so
+        // look it up again afterwards
+        waitForIo(shard, lock, fid);
+      } while (true);
+      if (frameAllocated)
+      {
+        if (descOf(fid).evictable())
+        {
+          shard.numUnpinned--;
+        }
+        unmapFrame(shardNo, fid);
+        shard.policy->recordRemove(indexOf(fid));
+        shard.freeFrames.push_back(indexOf(fid));
+      }
+    }
+    file.deletePage(PageNo);
+  }
+
+  void BufMgr::resize(std::uint32_t newBufs)
+  {
+    std::lock_guard<std::mutex> resizing(resizeMutex);
+    newBufs = std::max(newBufs, numShards);
+    if (newBufs > bufPool.capacity())
+    {
+      throw BufferExceededException();
+    }
+    // frames are in the arena before any shard hands them out, and leave it
+    // once no shard uses them
+    if (newBufs > bufPool.size())
+    {
+      bufPool.resize(newBufs);
+    }
+
     try
     {
-      hashTable.lookup(file, PageNo, fid);
+      for (std::uint32_t s = 0; s < numShards; s++)
+      {
+        resizeShard(s, newBufs / numShards + (s < newBufs % numShards ? 1 : 0));
+      }
     }
-    catch (const HashNotFoundException &e)
+    catch (...)
     {
-      frameAllocated = false;
+      std::uint32_t total = 0;
+      for (std::uint32_t s = 0; s < numShards; s++)
+      {
+        std::lock_guard<std::mutex> lock(shards[s]->latch);
+        total += shards[s]->numFrames;
+      }
+      numBufs = total;
+      throw;
     }
-    if (frameAllocated)
+    numBufs = newBufs;
+    missRatio.cover(newBufs);
+    pageTable.resize(HASHTABLE_SZ(newBufs));
+    if (newBufs < bufPool.size())
     {
-      bufDescTable[fid].clear();
-      hashTable.remove(file, PageNo);
+      bufPool.resize(newBufs);
     }
-    file.deletePage(PageNo);
+  }
+
+  void BufMgr::resizeShard(std::uint32_t shardNo, std::uint32_t frames)
+  {
+    BufShard &shard = *shards[shardNo];
+    std::unique_lock<std::mutex> lock(shard.latch);
+
+    if (frames > shard.numFrames)
+    {
+      for (std::uint32_t i = shard.numFrames; i < frames; i++)
+      {
+        shard.descs.emplace_back();
+        shard.descs.back().frameNo = frameOf(shardNo, i);
+      }
+      for (std::uint32_t i = frames; i > shard.numFrames; i--)
+      {
+        shard.freeFrames.push_back(i - 1);
+      }
+      shard.policy->resize(frames);
+      shard.hashTable.resize(HASHTABLE_SZ(frames));
+      shard.numFrames = frames;
+      return;
+    }
+
+    // Frames under I/O cannot be moved; wait until none of the frames to be
+    // removed is, then check for pins while holding the latch throughout.
+    std::uint32_t i = frames;
+    while (i < shard.numFrames)
+    {
+      const BufDesc &desc = shard.descs[i];
+      if (desc.writing || desc.loading)
+      {
+        waitForIo(shard, lock, desc.frameNo);
+        i = frames;
+        continue;
+      }
+      i++;
+    }
+    for (i = frames; i < shard.numFrames; i++)
+    {
+      const BufDesc &desc = shard.descs[i];
+      if (desc.valid && desc.pinCnt > 0)
+      {
+        throw PagePinnedException(desc.file->filename(), desc.pageNo,
+                                  desc.frameNo);
+      }
+    }
+
+    // only free frames that stay can take the pages being moved
+    shard.freeFrames.erase(
+        std::remove_if(shard.freeFrames.begin(), shard.freeFrames.end(),
+                       [frames](std::uint32_t index) { return index >= frames; }),
+        shard.freeFrames.end());
+    for (i = frames; i < shard.numFrames; i++)
+    {
+      BufDesc &from = shard.descs[i];
+      if (!from.valid)
+      {
+        continue;
+      }
+      if (!shard.freeFrames.empty())
+      {
+        std::uint32_t j = shard.freeFrames.back();
+        shard.freeFrames.pop_back();
+        BufDesc &to = shard.descs[j];
+        File file = *from.file;
+        const PageId pageNo = from.pageNo;
+        const bool dirty = from.dirty;
+        const bool refbit = from.refbit;
+        const bool ringPage = from.ringPage;
+        bufPool[to.frameNo] = bufPool[from.frameNo];
+        unmapFrame(shardNo, from.frameNo);
+        mapFrame(shardNo, to.frameNo, file, pageNo);
+        to.pinCnt = 0;
+        to.refbit = refbit;
+        to.ringPage = ringPage;
+        if (dirty)
+        {
+          markDirty(shardNo, to.frameNo);
+        }
+        shard.policy->recordRemove(i);
+        shard.policy->recordLoad(j, pageKey(file, pageNo));
+        continue;
+      }
+      try
+      {
+        evictFrame(shardNo, i);
+      }
+      catch (...)
+      {
+        // leave the shard at its old size, with the frames emptied so far
+        // back on the free list
+        for (std::uint32_t k = frames; k < shard.numFrames; k++)
+        {
+          if (!shard.descs[k].valid)
+          {
+            shard.policy->recordRemove(k);
+            shard.freeFrames.push_back(k);
+          }
+        }
+        throw;
+      }
+      shard.policy->recordRemove(i);
+    }
+
+    shard.policy->resize(frames);
+    shard.descs.resize(frames);
+    shard.hashTable.resize(HASHTABLE_SZ(frames));
+    shard.numFrames = frames;
+    shard.writerHand = 0;
   }
 
   void BufMgr::printSelf(void)
   {
     int validFrames = 0;
 
-    for (FrameId i = 0; i < numBufs; i++)
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      locks.emplace_back(shards[s]->latch);
+    }
+
+    // shards may differ in size by more than one after a failed resize()
+    FrameId end = 0;
+    for (std::uint32_t s = 0; s < numShards; s++)
+    {
+      end = std::max(end, frameOf(s, shards[s]->numFrames));
+    }
+    for (FrameId i = 0; i < end; i++)
     {
+      if (indexOf(i) >= shards[i % numShards]->numFrames)
+        continue;
       std::cout << "FrameNo:" << i << " ";
-      bufDescTable[i].Print();
+      descOf(i).Print();
 
-      if (bufDescTable[i].valid)
+      if (descOf(i).valid)
         validFrames++;
     }
 
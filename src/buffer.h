@@ -8,11 +8,28 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "bufHashTbl.h"
+#include "buf_stats.h"
+#include "buf_trace.h"
+#include "concurrent_page_table.h"
 #include "file.h"
+#include "frame_arena.h"
+#include "io_engine.h"
+#include "miss_ratio.h"
+#include "replacement_policy.h"
 
 namespace badgerdb {
 
@@ -21,6 +38,11 @@ namespace badgerdb {
  */
 class BufMgr;
 
+/**
+ * forward declaration of SwizzledPageRef class
+ */
+class SwizzledPageRef;
+
 /**
  * @brief Class for maintaining information about buffer pool frames
  */
@@ -34,9 +56,15 @@ class BufDesc {
  private:
   friend class BufMgr;
   /**
-   * Pointer to file to which corresponding frame is assigned
+   * Number of the file to which corresponding frame is assigned, 0 if none
+   */
+  FileId fileId;
+
+  /**
+   * File to which corresponding frame is assigned, owned by the shard's
+   * fileFrames entry for fileId; NULL if none
    */
-  File file;
+  File* file;
 
   /**
    * Page within file to which corresponding frame is assigned
@@ -64,7 +92,32 @@ class BufDesc {
   bool valid;
 
   /**
-   * Has this buffer frame been reference recently
+   * True while the background writer is writing this page out.  The frame
+   * cannot be evicted or cleared until the write completes.
+   */
+  bool writing;
+
+  /**
+   * True while the page is being read into this frame.  The frame is already
+   * in the hash table; readers wait for the read instead of issuing their own.
+   */
+  bool loading;
+
+  /**
+   * True if the page was loaded through a BufAccessStrategy ring and nobody
+   * else has used it since, so the ring may recycle the frame
+   */
+  bool ringPage;
+
+  /**
+   * References swizzled to this frame, unswizzled when the page leaves it
+   */
+  std::vector<SwizzledPageRef*> swizzledRefs;
+
+  /**
+   * Has this buffer frame been referenced since it was loaded.  Recency
+   * information used for replacement is kept by the shard's
+   * ReplacementPolicy.
    */
   bool refbit;
 
@@ -73,11 +126,23 @@ class BufDesc {
    */
   void clear() {
     pinCnt = 0;
-    file = File();
+    fileId = 0;
+    file = NULL;
     pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
     valid = false;
+    writing = false;
+    loading = false;
+    ringPage = false;
+    swizzledRefs.clear();
+  }
+
+  /**
+   * Returns true if the page in this frame may be evicted
+   */
+  bool evictable() const {
+    return valid && pinCnt == 0 && !writing && !loading;
   }
 
   /**
@@ -85,21 +150,24 @@ class BufDesc {
    * page in the file. Called when a frame in buffer pool is allocated to any
    * page in the file through readPage() or allocPage()
    *
-   * @param filePtr	File object
+   * @param filePtr	File object, kept by the shard while it has pages of the
+   * file
    * @param pageNum	Page number in the file
    */
-  void Set(File& file, PageId pageNum) {
-    this->file = file;
+  void Set(File* filePtr, PageId pageNum) {
+    fileId = filePtr->id();
+    file = filePtr;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
     refbit = true;
+    ringPage = false;
   }
 
   void Print() {
-    if (file.isValid()) {
-      std::cout << "file:" << file.filename() << " ";
+    if (file) {
+      std::cout << "file:" << file->filename() << " ";
       std::cout << "pageNo:" << pageNo << " ";
     } else
       std::cout << "file:NULL ";
@@ -112,167 +180,1322 @@ class BufDesc {
 };
 
 /**
- * @brief Class to maintain statistics of buffer usage
+ * @brief Settings of the background dirty page writer.
+ *
+ * Every intervalMs the writer visits each shard, starting at the frame the
+ * replacement policy will look at next, and writes out dirty unpinned pages
+ * so that victims are usually clean by the time a miss needs them.  It always
+ * cleans the next lookahead frames of a shard, and keeps going while more than
+ * dirtyRatioTarget of the shard's frames are dirty.  At most maxPagesPerRound
+ * pages are written per round over all shards, and each round starts at the
+ * shard after the one the previous round started at.
+ */
+struct BufWriterConfig {
+  /**
+   * Run the background writer
+   */
+  bool enabled;
+
+  /**
+   * Milliseconds between writer rounds
+   */
+  std::uint32_t intervalMs;
+
+  /**
+   * Maximum number of pages written per round
+   */
+  std::uint32_t maxPagesPerRound;
+
+  /**
+   * Number of frames ahead of the replacement sweep that are always cleaned
+   */
+  std::uint32_t lookahead;
+
+  /**
+   * Fraction of frames the writer lets stay dirty
+   */
+  double dirtyRatioTarget;
+
+  /**
+   * Constructor of BufWriterConfig class, with the writer disabled
+   */
+  BufWriterConfig()
+      : enabled(false),
+        intervalMs(10),
+        maxPagesPerRound(64),
+        lookahead(16),
+        dirtyRatioTarget(0.1) {}
+};
+
+/**
+ * @brief Outcome of the BufMgr calls that report failure with a return value
+ * instead of an exception.
+ */
+enum class BufResult {
+  /**
+   * The call succeeded
+   */
+  OK,
+
+  /**
+   * No frame could be allocated, where the throwing call raises
+   * BufferExceededException
+   */
+  BUFFER_EXCEEDED,
+
+  /**
+   * The page is not in the buffer pool
+   */
+  PAGE_NOT_RESIDENT,
+
+  /**
+   * The page is not pinned, where the throwing call raises
+   * PageNotPinnedException
+   */
+  PAGE_NOT_PINNED
+};
+
+/**
+ * @brief Frame and version of a page, for reading it without pinning.
+ *
+ * A reference is filled in by BufMgr::optimisticRef() and stays usable as
+ * long as the page stays in its frame and is not written.  A default
+ * constructed reference is never valid.
+ */
+struct OptimisticRef {
+  /**
+   * Frame holding the page
+   */
+  FrameId frame;
+
+  /**
+   * Version of the frame when the reference was taken; always even
+   */
+  std::uint64_t version;
+
+  /**
+   * Constructor of OptimisticRef class, making an invalid reference
+   */
+  OptimisticRef() : frame(0), version(1) {}
+};
+
+/**
+ * @brief Reference to a page that remembers the frame holding it.
+ *
+ * While the page is in the buffer pool the reference is swizzled: it holds
+ * the frame number, and BufMgr::readPage() pins that frame directly instead
+ * of hashing the file and page number and probing the hash table.  When
+ * the page is evicted, disposed or moved, the buffer manager unswizzles the
+ * reference back to its page number, and the next read goes through the
+ * hash table and swizzles it again.
+ *
+ * Structures that follow page links, such as next_page_number chains, can
+ * keep one reference per link.  A reference is used with a single BufMgr,
+ * must not outlive it, and must not be destroyed while another thread reads
+ * through it.
+ */
+class SwizzledPageRef {
+ public:
+  /**
+   * Constructor of SwizzledPageRef class, making an unswizzled reference
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file
+   */
+  SwizzledPageRef(const File& file, PageId pageNo);
+
+  /**
+   * Removes the reference from the buffer manager if it is swizzled.
+   */
+  ~SwizzledPageRef();
+
+  SwizzledPageRef(const SwizzledPageRef&) = delete;
+  SwizzledPageRef& operator=(const SwizzledPageRef&) = delete;
+
+  /**
+   * Returns the file of the page.
+   */
+  const File& file() const { return file_; }
+
+  /**
+   * Returns the page number of the page.
+   */
+  PageId page_number() const { return page_no_; }
+
+  /**
+   * Returns true if the reference currently holds a frame number.
+   */
+  bool isSwizzled() const {
+    return frame_.load(std::memory_order_acquire) != NOT_SWIZZLED;
+  }
+
+ private:
+  friend class BufMgr;
+
+  /**
+   * Value of frame_ while the reference is not swizzled
+   */
+  static const FrameId NOT_SWIZZLED = ~FrameId(0);
+
+  /**
+   * File of the page
+   */
+  File file_;
+
+  /**
+   * Page number of the page
+   */
+  PageId page_no_;
+
+  /**
+   * Page key of the page
+   */
+  const std::uint64_t key_;
+
+  /**
+   * Frame holding the page, or NOT_SWIZZLED.  Changed only under the latch
+   * of the shard owning the frame.
+   */
+  std::atomic<FrameId> frame_;
+
+  /**
+   * Buffer manager the reference was swizzled by
+   */
+  std::atomic<BufMgr*> mgr_;
+};
+
+/**
+ * @brief One independently latched partition of the buffer pool.
+ *
+ * Every (file, page) pair hashes to exactly one shard, and that shard owns the
+ * hash table entries for its pages together with the frames they are loaded
+ * into.  Shard i owns the frames i, i + numShards, i + 2 * numShards, ... so
+ * frame ownership can be computed without a lookup.
  */
-struct BufStats {
+class BufShard {
+ public:
+  /**
+   * Constructor of BufShard class
+   *
+   * @param frames  Number of buffer frames owned by this shard
+   * @param policy  Replacement policy used to pick victims in this shard
+   */
+  BufShard(std::uint32_t frames, ReplacementPolicyType policy);
+
+ private:
+  friend class BufMgr;
+
+  /**
+   * Latch protecting every member of this shard as well as the BufDesc
+   * entries of the frames it owns
+   */
+  std::mutex latch;
+
+  /**
+   * Signalled whenever a background write or a page read into one of this
+   * shard's frames completes
+   */
+  std::condition_variable ioDone;
+
+  /**
+   * Number of frames owned by this shard
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * BufDesc objects of this shard's frames, indexed 0 to numFrames-1.  A
+   * deque so that resizing the shard leaves the other entries in place.
+   */
+  std::deque<BufDesc> descs;
+
+  /**
+   * Replacement policy over this shard's frames, indexed 0 to numFrames-1
+   */
+  std::unique_ptr<ReplacementPolicy> policy;
+
+  /**
+   * Indices of this shard's frames that do not hold a page
+   */
+  std::vector<std::uint32_t> freeFrames;
+
+  /**
+   * Number of this shard's frames for which BufDesc::evictable() holds, ie.
+   * the frames the replacement policy may evict
+   */
+  std::uint32_t numUnpinned;
+
+  /**
+   * Number of this shard's frames holding a dirty page
+   */
+  std::uint32_t numDirty;
+
+  /**
+   * Next frame index the background writer looks at when the replacement
+   * policy has no sweep position
+   */
+  std::uint32_t writerHand;
+
+  /**
+   * Hash table mapping (File, page) to frame for the pages of this shard
+   */
+  BufHashTbl hashTable;
+
+  /**
+   * Frames of one file within a shard
+   */
+  struct FileFrames {
+    /**
+     * The file, referred to by the descriptors of its frames
+     */
+    File file;
+
+    /**
+     * Indices of the frames holding a page of the file
+     */
+    std::unordered_set<std::uint32_t> frames;
+
+    /**
+     * Subset of frames whose page is dirty
+     */
+    std::unordered_set<std::uint32_t> dirty;
+  };
+
   /**
-   * Total number of accesses to buffer pool
+   * Frames of this shard by the number of the file whose page they hold.
+   * Only files with at least one page in the shard have an entry.
    */
-  int accesses;
+  std::unordered_map<FileId, FileFrames> fileFrames;
+};
 
+/**
+ * @brief Buffer access strategy confining a scan to a small ring of frames.
+ *
+ * Pages read through a strategy are loaded into the frames of its ring, which
+ * are recycled as the scan moves on instead of evicting other pages, in the
+ * manner of PostgreSQL's bulk read strategy.  A frame whose page someone else
+ * has read in the meantime, or that is still pinned, is left to the
+ * replacement policy and replaced in the ring by a newly allocated frame.
+ * Since pages are partitioned over shards, the ring is split into one ring per
+ * shard, each at most an eighth of the shard's frames.
+ *
+ * A strategy may be shared by several threads, and must not outlive the
+ * BufMgr it was created for.
+ */
+class BufAccessStrategy {
+ public:
   /**
-   * Number of pages read from disk (including allocs)
+   * Constructor of BufAccessStrategy class
+   *
+   * @param bufMgr  Buffer manager the strategy is used with
+   * @param frames  Total number of frames in the ring
    */
-  int diskreads;
+  BufAccessStrategy(const BufMgr& bufMgr, std::uint32_t frames = 32);
+
+ private:
+  friend class BufMgr;
 
   /**
-   * Number of pages written back to disk
+   * Ring of each shard, guarded by that shard's latch
    */
-  int diskwrites;
+  std::vector<std::vector<FrameId>> rings;
 
   /**
-   * Clear all values
+   * Total number of frames in the ring
    */
-  void clear() { accesses = diskreads = diskwrites = 0; }
+  std::uint32_t frames;
 
   /**
-   * Constructor of BufStats class
+   * Position in each shard's ring of the next frame to recycle
    */
-  BufStats() { clear(); }
+  std::vector<std::uint32_t> cursors;
 };
 
 /**
  * @brief The central class which manages the buffer pool including frame
  * allocation and deallocation to pages in the file
+ *
+ * The pool is split into BufShard partitions.  Operations on a page only take
+ * the latch of the shard the page hashes to, so hits on pages of different
+ * shards proceed in parallel and no operation on a single page takes a
+ * pool-wide lock.  A page can only be loaded into a frame of its own shard, so
+ * with more than one shard BufferExceededException is raised once the frames
+ * of that shard are all pinned.
+ *
+ * Misses are also checked for sequential access per file.  Once a file has
+ * been read in order for long enough, its misses go through a
+ * BufAccessStrategy ring so the scan does not flush the rest of the pool.
  */
 class BufMgr {
  private:
+  friend class BufAccessStrategy;
+  friend class SwizzledPageRef;
+
+  /**
+   * Number of frames in the buffer pool
+   */
+  std::atomic<std::uint32_t> numBufs;
+
   /**
-   * Current position of clockhand in our buffer pool
+   * Number of shards the buffer pool is partitioned into
    */
-  FrameId clockHand;
+  std::uint32_t numShards;
 
   /**
-   * Number of frames in the buffer pool
+   * Independently latched partitions of the buffer pool
    */
-  std::uint32_t numBufs;
+  std::vector<std::unique_ptr<BufShard>> shards;
 
   /**
-   * Hash table mapping (File, page) to frame
+   * Returns the BufDesc object holding information about a frame allocation
+   * from 'bufPool' (the buffer pool).  The caller must hold the latch of the
+   * shard owning the frame.
+   *
+   * @param frame   Frame number in the buffer pool
    */
-  BufHashTbl hashTable;
+  BufDesc& descOf(FrameId frame) {
+    return shards[frame % numShards]->descs[frame / numShards];
+  }
+
+  /**
+   * Serializes resize() calls
+   */
+  std::mutex resizeMutex;
+
+  /**
+   * Grow or shrink one shard to the given number of frames, see resize().
+   *
+   * @param shard   Index of the shard
+   * @param frames  New number of frames of the shard, at least 1
+   * @throws PagePinnedException If a page in a frame to be removed is pinned
+   */
+  void resizeShard(std::uint32_t shard, std::uint32_t frames);
+
+  /**
+   * Maintains Buffer pool usage statistics, per file and per thread
+   */
+  BufStatsCollector bufStats;
+
+  /**
+   * Estimates the hit ratio the pool would have at other sizes.  Mutable
+   * because predictions first take in the accesses it has queued.
+   */
+  mutable MissRatioEstimator missRatio;
 
   /**
-   * Array of BufDesc objects to hold information corresponding to every frame
-   * allocation from 'bufPool' (the buffer pool)
+   * Frames of the loaded pages of every shard, for lookups that take no
+   * latch.  A page is entered once its contents are in the frame and removed
+   * before the frame's version changes when it leaves.
    */
-  std::vector<BufDesc> bufDescTable;
+  ConcurrentPageTable pageTable;
 
   /**
-   * Maintains Buffer pool usage statistics
+   * True while an access trace is being recorded, checked before touching
+   * tracer
    */
-  BufStats bufStats;
+  std::atomic<bool> tracing;
 
   /**
-   * Advance clock to next frame in the buffer pool
+   * Writer of the access trace, or NULL.  Accessed with std::atomic_load()
+   * and std::atomic_store() so that tracing can stop while calls are running.
    */
-  void advanceClock();
+  std::shared_ptr<BufTraceWriter> tracer;
 
   /**
-   * Allocate a free frame.
+   * Record a call in the access trace, if one is being recorded.
    *
-   * @param frame   	Frame reference, frame ID of allocated frame returned
-   * via this variable
-   * @throws BufferExceededException If no such buffer is found which can be
-   * allocated
+   * @param op      Call that was made
+   * @param file    File the call was made for
+   * @param pageNo  Page the call was made for
+   * @param dirty   True if an unpin marked the page dirty
    */
-  void allocBuf(FrameId& frame);
+  void trace(BufTraceOp op, const File& file, PageId pageNo,
+             bool dirty = false);
 
- public:
   /**
-   * Actual buffer pool from which frames are allocated
+   * Background writer settings
    */
-  std::vector<Page> bufPool;
+  BufWriterConfig writerConfig;
 
   /**
-   * Constructor of BufMgr class
+   * Background writer thread, if enabled
    */
-  BufMgr(std::uint32_t bufs);
+  std::thread writer;
 
   /**
-   * Reads the given page from the file into a frame and returns the pointer to
-   * page. If the requested page is already present in the buffer pool pointer
-   * to that frame is returned otherwise a new frame is allocated from the
-   * buffer pool for reading the page.
+   * Guards stopWriter and is used to wake the writer up early
+   */
+  std::mutex writerMutex;
+
+  /**
+   * Signalled to stop the background writer
+   */
+  std::condition_variable writerWake;
+
+  /**
+   * Set when the background writer should exit
+   */
+  bool stopWriter;
+
+  /**
+   * Main loop of the background writer thread
+   */
+  void writerLoop();
+
+  /**
+   * Write out dirty unpinned pages of a shard ahead of its replacement sweep.
    *
-   * @param file   	File object
-   * @param PageNo  Page number in the file to be read
-   * @param page  	Reference to page pointer. Used to fetch the Page object
-   * in which requested page from file is read in.
+   * @param shard   Index of the shard to clean
+   * @param budget  Maximum number of pages to write
+   * @return        Number of pages written
    */
-  void readPage(File& file, const PageId pageNo, Page*& page);
+  std::uint32_t cleanShard(std::uint32_t shard, std::uint32_t budget);
 
   /**
-   * Unpin a page from memory since it is no longer required for it to remain in
-   * memory.
+   * Wait until no write or read of a frame is in flight.  The caller must
+   * hold the latch of the frame's shard through lock.
    *
-   * @param file   	File object
-   * @param PageNo  Page number
-   * @param dirty		True if the page to be unpinned needs to be
-   * marked dirty
-   * @throws  PageNotPinnedException If the page is not already pinned
+   * @param shard   Shard owning the frame
+   * @param lock    Lock held on the shard latch
+   * @param frame   Frame number in the buffer pool
    */
-  void unPinPage(File& file, const PageId pageNo, const bool dirty);
+  void waitForIo(BufShard& shard, std::unique_lock<std::mutex>& lock,
+                 FrameId frame);
 
   /**
-   * Allocates a new, empty page in the file and returns the Page object.
-   * The newly allocated page is also assigned a frame in the buffer pool.
+   * tryReadPage() without recording the call in the access trace.
+   *
+   * @param batched   True for a page of readPages(), which has already
+   * recorded the access in the miss ratio curve and whose misses are not
+   * used for scan detection
+   */
+  BufResult fetchPage(File& file, const PageId pageNo, Page*& page,
+                      BufAccessStrategy* strategy, bool batched = false);
+
+  /**
+   * tryUnPinPage() without recording the call in the access trace.
    *
    * @param file   	File object
-   * @param PageNo  Page number. The number assigned to the page in the file is
-   * returned via this reference.
-   * @param page  	Reference to page pointer. The newly allocated in-memory
-   * Page object is returned via this reference.
+   * @param pageNo  Page number
+   * @param dirty		True if the page to be unpinned needs to be marked dirty
+   * @param fid     Frame reference, frame of the page returned via this
+   * variable if it is in the pool
    */
-  void allocPage(File& file, PageId& pageNo, Page*& page);
+  BufResult releasePage(File& file, const PageId pageNo, const bool dirty,
+                        FrameId& fid);
 
   /**
-   * Writes out all dirty pages of the file to disk.
-   * All the frames assigned to the file need to be unpinned from buffer pool
-   * before this function can be successfully called. Otherwise Error returned.
+   * Read a page that is not in the buffer pool into a frame of its shard.
+   * The frame is entered in the hash table in the loading state before the
+   * shard latch is released for the read, so concurrent readers of the same
+   * page wait for this read.  The caller must hold the shard latch through
+   * lock, and must have checked that the page is not in the pool.
    *
+   * @param shard   Index of the shard the page belongs to
+   * @param key     Page key of the page
    * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the
-   * buffer pool
-   * @throws BadBufferException If any frame allocated to the file is found to
-   * be invalid
+   * @param pageNo  Page number in the file
+   * @param lock    Lock held on the shard latch
+   * @param strategy  Ring to load the page through, or NULL
+   * @param frame   Frame reference, frame holding the page, pinned once,
+   * returned via this variable
+   * @return        False if no frame can be allocated
+   * @throws InvalidPageException If the page does not exist in the file
    */
-  void flushFile(File& file);
+  bool loadPage(std::uint32_t shard, std::uint64_t key, File& file,
+                const PageId pageNo, std::unique_lock<std::mutex>& lock,
+                BufAccessStrategy* strategy, FrameId& frame);
 
   /**
-   * Delete page from file and also from buffer pool if present.
-   * Since the page is entirely deleted from file, its unnecessary to see if the
-   * page is dirty.
+   * First half of loadPage(): allocate a frame for a page that is not in the
+   * buffer pool and enter it in the hash table in the loading state.  The
+   * caller must hold the shard latch, then read the page into the frame
+   * without it and finish with completeLoad() or abortLoad().
    *
+   * @param shard   Index of the shard the page belongs to
+   * @param key     Page key of the page
    * @param file   	File object
-   * @param PageNo  Page number
+   * @param pageNo  Page number in the file
+   * @param strategy  Ring to load the page through, or NULL
+   * @param frame   Frame reference, frame reserved for the page, pinned once,
+   * returned via this variable
+   * @return        False if no frame can be allocated
    */
-  void disposePage(File& file, const PageId PageNo);
+  bool reserveFrame(std::uint32_t shard, std::uint64_t key, File& file,
+                    const PageId pageNo, BufAccessStrategy* strategy,
+                    FrameId& frame);
 
   /**
-   * Print member variable values.
+   * The page has been read into a frame returned by reserveFrame().  The
+   * caller must hold the shard latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param key     Page key of the page
+   * @param frame   Frame number in the buffer pool
    */
-  void printSelf();
+  void completeLoad(std::uint32_t shard, std::uint64_t key, FrameId frame);
 
   /**
-   * Get buffer pool usage statistics
+   * Reading the page into a frame returned by reserveFrame() failed; return
+   * the frame to the free list.  The caller must hold the shard latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
    */
-  BufStats& getBufStats() { return bufStats; }
+  void abortLoad(std::uint32_t shard, FrameId frame);
 
   /**
-   * Clear buffer pool usage statistics
+   * Pin the page in a frame that was found in the hash table and is not
+   * loading.  The caller must hold the shard latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   * @param strategy  Strategy of the access, or NULL for a regular access
+   */
+  void pinFrame(std::uint32_t shard, FrameId frame,
+                BufAccessStrategy* strategy);
+
+  /**
+   * Drop one pin from the page in a frame.  The caller must hold the shard
+   * latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   * @param dirty   True if the page is to be marked dirty
+   * @return        False if the page was not pinned
+   */
+  bool unpinFrame(std::uint32_t shard, FrameId frame, const bool dirty);
+
+  /**
+   * Assign a page to a free frame: set up its BufDesc, pinned once, and
+   * enter it in the shard's hash table and file index.  The caller must hold
+   * the shard latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   */
+  void mapFrame(std::uint32_t shard, FrameId frame, File& file,
+                const PageId pageNo);
+
+  /**
+   * Returns true if the version of the frame of ref has not changed since
+   * ref was taken, ie. everything read from the frame since is consistent.
+   */
+  bool validate(const OptimisticRef& ref) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return bufPool.version(ref.frame).load(std::memory_order_relaxed) ==
+           ref.version;
+  }
+
+  /**
+   * Undo mapFrame(): remove the page in a frame from the shard's hash table
+   * and file index, forget that it is dirty and clear the BufDesc.  The
+   * caller must hold the shard latch and takes care of the free list, the
+   * unpinned count and the replacement policy.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   */
+  void unmapFrame(std::uint32_t shard, FrameId frame);
+
+  /**
+   * Point a reference at the frame holding its page.  Does nothing if the
+   * reference is already swizzled.  The caller must hold the shard's latch.
+   *
+   * @param frame   Frame holding the page of the reference
+   * @param ref     Reference to swizzle
+   */
+  void swizzle(FrameId frame, SwizzledPageRef& ref);
+
+  /**
+   * Point all references to a frame back at their pages.  The caller must
+   * hold the shard's latch.
+   *
+   * @param frame   Frame whose page is leaving it
+   */
+  void unswizzleFrame(FrameId frame);
+
+  /**
+   * Forget a reference that is being destroyed.
+   *
+   * @param ref     Reference to remove
+   */
+  void unswizzle(SwizzledPageRef& ref);
+
+  /**
+   * Mark the page in a frame dirty, keeping the shard's dirty count and the
+   * file's dirty set in step.  The caller must hold the shard latch.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   */
+  void markDirty(std::uint32_t shard, FrameId frame);
+
+  /**
+   * Mark the page in a frame clean, see markDirty().
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param frame   Frame number in the buffer pool
+   */
+  void markClean(std::uint32_t shard, FrameId frame);
+
+  /**
+   * Keeps the reads of batches of misses and prefetches, and the writes of
+   * checkpoints, in flight at once.  Created by ioEngine() on first use, so
+   * that a buffer manager that only does single page I/O starts no ring or
+   * threads.
+   */
+  std::unique_ptr<IoEngine> io;
+
+  /**
+   * Guards the creation of io
+   */
+  std::once_flag ioOnce;
+
+  /**
+   * Returns the I/O engine, creating it the first time.
+   */
+  IoEngine& ioEngine();
+
+  /**
+   * A page queued for prefetching
+   */
+  struct PrefetchRequest {
+    File file;
+    PageId pageNo;
+  };
+
+  /**
+   * Pages waiting to be prefetched, oldest first
+   */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+  /**
+   * Prefetch thread, started by the first prefetch request
+   */
+  std::thread prefetcher;
+
+  /**
+   * Guards prefetchQueue, prefetcher and stopPrefetch
+   */
+  std::mutex prefetchMutex;
+
+  /**
+   * Signalled when requests are queued or the prefetcher should stop
+   */
+  std::condition_variable prefetchWake;
+
+  /**
+   * Set when the prefetch thread should exit
+   */
+  bool stopPrefetch;
+
+  /**
+   * Main loop of the prefetch thread
+   */
+  void prefetchLoop();
+
+  /**
+   * Load pages into unpinned frames unless they are already in the pool, all
+   * reads at once.  Pages that do not exist or do not fit are skipped.
+   *
+   * @param file   	File object
+   * @param pageIds Page numbers in the file
+   */
+  void prefetchPages(File& file, const std::vector<PageId>& pageIds);
+
+  /**
+   * Maximum number of queued pages of a file the prefetch thread loads at a
+   * time; their frames are reserved until the reads complete
+   */
+  static const std::uint32_t PREFETCH_BATCH = 16;
+
+  /**
+   * Returns the key identifying a page to the shards and replacement policies
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @return  			64 bit page key
+   */
+  static std::uint64_t pageKey(const File& file, const PageId pageNo);
+
+  /**
+   * Returns the index of the shard responsible for a page
+   *
+   * @param key     Page key returned by pageKey()
+   * @return  			Shard index between 0 and numShards-1
+   */
+  std::uint32_t shardOf(std::uint64_t key) const { return key % numShards; }
+
+  /**
+   * Returns the frame number of a shard-local frame index
+   *
+   * @param shard   Shard index
+   * @param index   Index of the frame within the shard
+   * @return  			Frame number in the buffer pool
+   */
+  FrameId frameOf(std::uint32_t shard, std::uint32_t index) const {
+    return index * numShards + shard;
+  }
+
+  /**
+   * Returns the index of a frame within its shard
+   *
+   * @param frame   Frame number in the buffer pool
+   * @return  			Index of the frame within its shard
+   */
+  std::uint32_t indexOf(FrameId frame) const { return frame / numShards; }
+
+  /**
+   * Allocate a frame from a shard.  A frame from the shard's free list is used
+   * if there is one; otherwise the page chosen by the shard's replacement
+   * policy is evicted.  Fails without scanning when no page is unpinned.  The
+   * caller must hold the shard latch, and must report the page it loads into
+   * the frame to the policy.
+   *
+   * @param shard   Index of the shard to allocate from
+   * @param file    File of the page the frame is allocated for, which the
+   * victim search is counted against
+   * @param key     Page key of the page the frame is allocated for
+   * @param frame   	Frame reference, frame ID of allocated frame returned
+   * via this variable
+   * @param strategy  Ring to recycle a frame from and add the frame to, or
+   * NULL
+   * @return        False if no such buffer is found which can be allocated
+   */
+  bool allocBuf(std::uint32_t shard, const File& file, std::uint64_t key,
+                FrameId& frame, BufAccessStrategy* strategy = NULL);
+
+  /**
+   * Evict the page in a frame, writing it out first if it is dirty.  The
+   * caller must hold the shard latch and the frame must be evictable.  The
+   * replacement policy is not told.
+   *
+   * @param shard   Index of the shard owning the frame
+   * @param index   Index of the frame within the shard
+   */
+  void evictFrame(std::uint32_t shard, std::uint32_t index);
+
+  /**
+   * Sequential access state of a file, used to detect scans
+   */
+  struct ScanState {
+    /**
+     * Last page of the file that missed
+     */
+    PageId lastPage;
+
+    /**
+     * Number of consecutive misses at increasing, nearby page numbers
+     */
+    std::uint32_t run;
+
+    /**
+     * Ring used once the file is being scanned
+     */
+    std::shared_ptr<BufAccessStrategy> strategy;
+  };
+
+  /**
+   * Scan detection state by file name
+   */
+  std::unordered_map<FileId, ScanState> scans;
+
+  /**
+   * Guards scans, scanThreshold and scanRingFrames.  Only taken on misses.
+   */
+  std::mutex scanMutex;
+
+  /**
+   * Number of sequential misses after which a file is treated as being
+   * scanned, or 0 to disable scan detection
+   */
+  std::uint32_t scanThreshold;
+
+  /**
+   * Ring size of the strategy used for detected scans
+   */
+  std::uint32_t scanRingFrames;
+
+  /**
+   * Record a miss for scan detection.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number that missed
+   * @return        Strategy to load the page through, or empty if the file
+   * is not being scanned
+   */
+  std::shared_ptr<BufAccessStrategy> detectScan(const File& file,
+                                                const PageId pageNo);
+
+ public:
+  /**
+   * Actual buffer pool from which frames are allocated, one contiguous
+   * page-aligned block of Page::SIZE byte frames
+   */
+  FrameArena bufPool;
+
+  /**
+   * Constructor of BufMgr class
+   *
+   * @param bufs    Number of frames in the buffer pool
+   * @param shards  Number of independently latched shards the pool is split
+   * into, clamped to between 1 and bufs
+   * @param policy  Replacement policy used to pick victims
+   * @param writerSettings  Background dirty page writer settings
+   * @param hugePages  Back the buffer pool with transparent huge pages if the
+   * kernel allows it
+   * @param maxBufs  Number of frames resize() can grow the pool to, for which
+   * address space is reserved up front; 0 for GROWTH_FACTOR times bufs.
+   * Raised to bufs if smaller.
+   */
+  BufMgr(std::uint32_t bufs, std::uint32_t shards = 1,
+         ReplacementPolicyType policy = ReplacementPolicyType::CLOCK,
+         const BufWriterConfig& writerSettings = BufWriterConfig(),
+         bool hugePages = false, std::uint32_t maxBufs = 0);
+
+  /**
+   * Destructor of BufMgr class.  Stops the background writer and the prefetch
+   * thread, dropping prefetch requests that have not started.  Dirty pages
+   * still in the pool are not written out; use flushFile() for that.
+   */
+  ~BufMgr();
+
+  /**
+   * Reads the given page from the file into a frame and returns the pointer to
+   * page. If the requested page is already present in the buffer pool pointer
+   * to that frame is returned otherwise a new frame is allocated from the
+   * buffer pool for reading the page.  If the page is being read in by
+   * another thread or by prefetch(), waits for that read instead.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @param page  	Reference to page pointer. Used to fetch the Page object
+   * in which requested page from file is read in.
+   * @param strategy  Access strategy to load the page through on a miss, eg.
+   * for a scan, or NULL to let the buffer manager detect scans itself
+   */
+  void readPage(File& file, const PageId pageNo, Page*& page,
+                BufAccessStrategy* strategy = NULL);
+
+  /**
+   * readPage() that reports a full buffer pool with its return value instead
+   * of throwing, so that callers that expect it pay a branch rather than an
+   * exception.  Errors reading the file are still thrown.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @param page  	Reference to page pointer, set if the page is read
+   * @param strategy  Access strategy, see readPage()
+   * @return        OK, or BUFFER_EXCEEDED if no frame can be allocated
+   */
+  BufResult tryReadPage(File& file, const PageId pageNo, Page*& page,
+                        BufAccessStrategy* strategy = NULL);
+
+  /**
+   * Reads the page of a reference, like readPage().  If the reference is
+   * swizzled the frame it holds is pinned without a hash table lookup;
+   * otherwise the page is looked up or read in and the reference is swizzled
+   * to its frame.
+   *
+   * @param ref     Reference to the page
+   * @param page  	Reference to page pointer. Used to fetch the Page object
+   * in which requested page from file is read in.
+   * @param strategy  Access strategy, see readPage()
+   * @throws BufferExceededException If no frame can be allocated
+   */
+  void readPage(SwizzledPageRef& ref, Page*& page,
+                BufAccessStrategy* strategy = NULL);
+
+  /**
+   * Configure detection of sequential scans.
+   *
+   * @param threshold   Number of sequential misses on a file after which its
+   * misses are loaded through a ring, or 0 to disable detection
+   * @param ringFrames  Ring size used for detected scans
+   */
+  void setScanDetection(std::uint32_t threshold, std::uint32_t ringFrames);
+
+  /**
+   * Reads a batch of pages of the file, like readPage() for each of them.
+   * Every shard involved is latched once to pin the pages that are present
+   * and to reserve frames for the rest; the missing pages are then read
+   * without any latch held, all reads in flight at once.  Misses are not used
+   * for scan detection.  If any page cannot be read, no page of the batch is
+   * left pinned.
+   *
+   * @param file   	File object
+   * @param pageIds Page numbers in the file; may contain duplicates, in which
+   * case the page is pinned once per occurrence
+   * @param pages  	Resized to the number of pages; pages[i] is set to the
+   * page pageIds[i] is read into
+   * @param strategy  Access strategy to load missing pages through, or NULL
+   * @throws BufferExceededException If not enough frames can be allocated
+   * @throws InvalidPageException If a page does not exist in the file
+   */
+  void readPages(File& file, const std::vector<PageId>& pageIds,
+                 std::vector<Page*>& pages,
+                 BufAccessStrategy* strategy = NULL);
+
+  /**
+   * Asynchronously load pages into unpinned frames so that later readPage()
+   * calls for them are hits.  Pages queued for the same file are read
+   * PREFETCH_BATCH at a time.  Returns immediately; pages already in the
+   * pool, pages that do not exist and pages for which no frame is free are
+   * skipped.
+   *
+   * @param file   	File object
+   * @param pageIds Page numbers in the file, in the order to load them
+   */
+  void prefetch(File& file, const std::vector<PageId>& pageIds);
+
+  /**
+   * Asynchronously load a range of consecutive pages, see prefetch().
+   *
+   * @param file   	File object
+   * @param first   First page number in the file
+   * @param count   Number of pages
+   */
+  void prefetchRange(File& file, const PageId first, std::uint32_t count);
+
+  /**
+   * Unpin a page from memory since it is no longer required for it to remain in
+   * memory.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   * @param dirty		True if the page to be unpinned needs to be
+   * marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+  void unPinPage(File& file, const PageId pageNo, const bool dirty);
+
+  /**
+   * unPinPage() that reports its failures with its return value instead of
+   * throwing or printing.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   * @param dirty		True if the page to be unpinned needs to be
+   * marked dirty
+   * @return        OK, PAGE_NOT_RESIDENT if the page is not in the pool, or
+   * PAGE_NOT_PINNED if it is not pinned
+   */
+  BufResult tryUnPinPage(File& file, const PageId pageNo, const bool dirty);
+
+  /**
+   * Unpin the page of a reference, like unPinPage(), through the frame it
+   * holds if it is swizzled.
+   *
+   * @param ref     Reference to the page
+   * @param dirty		True if the page to be unpinned needs to be
+   * marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+  void unPinPage(SwizzledPageRef& ref, const bool dirty);
+
+  /**
+   * Unpin a batch of pages of the file, like unPinPage() for each of them,
+   * latching every shard involved once.  All pages that are pinned are
+   * unpinned even if some are not.
+   *
+   * @param file   	File object
+   * @param pageIds Page numbers in the file
+   * @param dirty		True if the pages need to be marked dirty
+   * @throws  PageNotPinnedException If one of the pages is not pinned
+   */
+  void unPinPages(File& file, const std::vector<PageId>& pageIds,
+                  const bool dirty);
+
+  /**
+   * Allocates a new, empty page in the file and returns the Page object.
+   * The newly allocated page is also assigned a frame in the buffer pool.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number. The number assigned to the page in the file is
+   * returned via this reference.
+   * @param page  	Reference to page pointer. The newly allocated in-memory
+   * Page object is returned via this reference.
+   */
+  void allocPage(File& file, PageId& pageNo, Page*& page);
+
+  /**
+   * allocPage() that reports a full buffer pool with its return value
+   * instead of throwing.  The page is then removed from the file again.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number, returned via this reference
+   * @param page  	Reference to page pointer, set if a frame is allocated
+   * @return        OK, or BUFFER_EXCEEDED if no frame can be allocated
+   */
+  BufResult tryAllocPage(File& file, PageId& pageNo, Page*& page);
+
+  /**
+   * Number of optimistic attempts readShared() makes before it pins the page
+   */
+  static const int OPTIMISTIC_ATTEMPTS = 3;
+
+  /**
+   * Take a reference for optimistic reads of a page in the buffer pool.
+   * A loaded page is found without taking a latch.  Waits if the page is
+   * being read in.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param ref     Reference, filled in if the page is in the pool
+   * @return        False if the page is not in the pool or is being written
+   */
+  bool optimisticRef(File& file, const PageId pageNo, OptimisticRef& ref);
+
+  /**
+   * Read a page without pinning it or taking a latch.  The page is passed to
+   * reader, which must copy out what it needs and must not trust it before
+   * this call returns true: the frame may be written or given to another
+   * page meanwhile, in which case reader sees a torn page and this returns
+   * false.  An exception thrown by reader is passed on only if the read
+   * turns out valid.
+   *
+   * @param ref     Reference taken by optimisticRef()
+   * @param reader  Callable taking a const Page&
+   * @return        True if reader saw a consistent copy of the page
+   */
+  template <typename Reader>
+  bool readOptimistic(const OptimisticRef& ref, Reader&& reader) {
+    if (ref.version & 1 || ref.frame >= bufPool.capacity() ||
+        bufPool.version(ref.frame).load(std::memory_order_acquire) !=
+            ref.version) {
+      return false;
+    }
+    try {
+      reader(static_cast<const Page&>(bufPool[ref.frame]));
+    } catch (...) {
+      if (validate(ref)) {
+        throw;
+      }
+      return false;
+    }
+    return validate(ref);
+  }
+
+  /**
+   * Read a page through ref, trying readOptimistic() a few times and
+   * refreshing ref in between, then falling back to pinning the page, which
+   * reads it in if needed.  ref is left valid for the next call where
+   * possible.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param ref     Reference to the page, possibly stale or invalid
+   * @param reader  Callable taking a const Page&, see readOptimistic()
+   * @throws BufferExceededException If the page has to be read in and no
+   * frame can be allocated
+   */
+  template <typename Reader>
+  void readShared(File& file, const PageId pageNo, OptimisticRef& ref,
+                  Reader&& reader) {
+    for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+      if (readOptimistic(ref, reader)) {
+        return;
+      }
+      if (!optimisticRef(file, pageNo, ref)) {
+        break;
+      }
+    }
+    Page* page;
+    readPage(file, pageNo, page);
+    try {
+      reader(static_cast<const Page&>(*page));
+    } catch (...) {
+      unPinPage(file, pageNo, false);
+      throw;
+    }
+    optimisticRef(file, pageNo, ref);
+    unPinPage(file, pageNo, false);
+  }
+
+  /**
+   * Announce that a pinned page is about to be changed, so that optimistic
+   * reads of it fail until endWrite().  Writers of a page that is read
+   * optimistically must bracket their changes with these calls, and must
+   * already be serialized among themselves.
+   *
+   * @param page    Pinned page, as returned by readPage() or allocPage()
+   */
+  void beginWrite(const Page* page) {
+    bufPool.version(bufPool.frameOf(page))
+        .fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  /**
+   * The changes announced by beginWrite() are complete.
+   *
+   * @param page    Page passed to beginWrite()
+   */
+  void endWrite(const Page* page) {
+    bufPool.version(bufPool.frameOf(page))
+        .fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * Writes out all dirty pages of the file to disk.
+   * All the frames assigned to the file need to be unpinned from buffer pool
+   * before this function can be successfully called. Otherwise Error returned.
+   * The dirty pages are written with checkpointFile() first.  Each shard
+   * keeps an index of the frames of every file, so the cost is proportional
+   * to the number of pages of the file in the pool.  Within a
+   * shard, no page is written or dropped if any page of the file is pinned.
+   *
+   * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the
+   * buffer pool
+   * @throws BadBufferException If any frame allocated to the file is found to
+   * be invalid
+   */
+  void flushFile(File& file);
+
+  /**
+   * Writes out the dirty, unpinned pages of the file without dropping them
+   * from the buffer pool.  The pages are collected from all shards and
+   * written CHECKPOINT_BATCH at a time, with runs of consecutive pages
+   * coalesced into single writes and the writes of a batch in flight at
+   * once.  Users may pin and
+   * modify the pages meanwhile.
+   *
+   * @param file   	File object
+   * @throws InvalidPageException If a page has been deleted from the file;
+   * the pages of that batch stay dirty
+   */
+  void checkpointFile(File& file);
+
+  /**
+   * Maximum number of pages checkpointFile() copies and writes at a time
+   */
+  static const std::uint32_t CHECKPOINT_BATCH = 128;
+
+  /**
+   * Delete page from file and also from buffer pool if present.
+   * Since the page is entirely deleted from file, its unnecessary to see if the
+   * page is dirty.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   */
+  void disposePage(File& file, const PageId PageNo);
+
+  /**
+   * Print member variable values.
+   */
+  void printSelf();
+
+  /**
+   * Get buffer pool usage statistics, summed over all files and threads
+   */
+  BufStats getBufStats() const { return bufStats.total(); }
+
+  /**
+   * Get buffer pool usage statistics of every file that has been used, by
+   * file name
+   */
+  std::map<std::string, BufStats> getBufStatsByFile() const {
+    return bufStats.byFile();
+  }
+
+  /**
+   * Clear buffer pool usage statistics
+   */
+  void clearBufStats() {
+    bufStats.clear();
+    missRatio.clear();
+  }
+
+  /**
+   * Get the predicted hit ratio of readPage() and allocPage() calls at 0.5,
+   * 1, 1.5, 2, 3 and 4 times the current number of frames, estimated from
+   * a sample of the accesses since the statistics were last cleared.  The
+   * prediction assumes LRU replacement and a single shard.
+   */
+  std::vector<MissRatioPoint> getMissRatioCurve() const;
+
+  /**
+   * Get the predicted hit ratio of readPage() and allocPage() calls at a
+   * given number of frames; see getMissRatioCurve().
+   *
+   * @param bufs    Number of frames
+   */
+  double predictHitRatio(std::uint32_t bufs) const {
+    return missRatio.hitRatio(bufs);
+  }
+
+  /**
+   * Configure the sampling of accesses for getMissRatioCurve(), discarding
+   * what was sampled so far.  A higher rate gives better estimates at a
+   * higher cost; the rate is lowered automatically when more than maxSamples
+   * pages are sampled.
+   *
+   * @param rate        Fraction of pages to sample, between 0 and 1
+   * @param maxSamples  Maximum number of pages sampled at a time
+   */
+  void setMissRatioSampling(double rate, std::uint32_t maxSamples) {
+    missRatio.configure(rate, maxSamples);
+  }
+
+  /**
+   * Start recording every readPage(), allocPage(), unPinPage(), disposePage()
+   * and flushFile() call, including the pages of the batched calls, in a
+   * binary trace file that can be replayed offline with the bufsim tool.
+   * Replaces a trace that is being recorded, closing it as stopTrace() does.
+   *
+   * @param path  Name of the trace file, which is overwritten
+   * @throws BadTraceException If the trace file cannot be created
+   * @throws FileIOException If the replaced trace could not be written
+   */
+  void startTrace(const std::string& path);
+
+  /**
+   * Stop recording the access trace and close the trace file.
+   *
+   * @throws FileIOException If any part of the trace could not be written,
+   * for example because the disk is full
+   */
+  void stopTrace();
+
+  /**
+   * How many times its initial size the pool can grow to by default.
+   * Address space is reserved for that many frames, so that resize() can
+   * grow the pool in place.
+   */
+  static const std::uint32_t GROWTH_FACTOR = 4;
+
+  /**
+   * Change the number of frames in the buffer pool while it is in use.
+   * Shards are resized one at a time, each under its latch, so readers only
+   * wait for the shard being resized.  Frames are added to, or taken from,
+   * the end of each shard.  The page in a frame that is taken away is moved
+   * to a free frame of its shard if there is one, and evicted otherwise,
+   * being written out first if it is dirty.  Each shard's hash table is
+   * rehashed incrementally by the operations that follow.
+   *
+   * If a page in a frame to be removed is pinned, the shards resized so far
+   * keep their new size and getNumBufs() reports the resulting size.
+   *
+   * @param newBufs New number of frames, raised to the number of shards if
+   * smaller
+   * @throws BufferExceededException If newBufs exceeds the reserved capacity
+   * @throws PagePinnedException If a page in a frame to be removed is pinned
+   */
+  void resize(std::uint32_t newBufs);
+
+  /**
+   * Returns the number of frames in the buffer pool
+   */
+  std::uint32_t getNumBufs() const { return numBufs; }
+
+  /**
+   * Returns the number of frames resize() can grow the pool to.
    */
-  void clearBufStats() { bufStats.clear(); }
+  std::uint32_t getMaxBufs() const { return bufPool.capacity(); }
 };
 
 }  // namespace badgerdb
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "concurrent_page_table.h"
+
+#include <thread>
+
+namespace badgerdb {
+
+namespace {
+
+std::uint32_t bucketsFor(std::uint32_t buckets) {
+  std::uint32_t size = 1;
+  while (size < buckets) {
+    size *= 2;
+  }
+  return size;
+}
+
+}  // namespace
+
+ConcurrentPageTable::Table::~Table() {
+  for (std::uint32_t i = 0; i <= mask; i++) {
+    Node* n = buckets[i].head.load(std::memory_order_relaxed);
+    while (n) {
+      Node* next = n->next.load(std::memory_order_relaxed);
+      delete n;
+      n = next;
+    }
+  }
+  delete[] buckets;
+}
+
+ConcurrentPageTable::ConcurrentPageTable(std::uint32_t buckets)
+    : table(new Table(bucketsFor(buckets))), count(0) {}
+
+ConcurrentPageTable::~ConcurrentPageTable() {
+  delete table.load(std::memory_order_relaxed);
+}
+
+void ConcurrentPageTable::lock(Bucket& bucket) {
+  while (bucket.locked.exchange(true, std::memory_order_acquire)) {
+    while (bucket.locked.load(std::memory_order_relaxed)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ConcurrentPageTable::unlock(Bucket& bucket) {
+  bucket.locked.store(false, std::memory_order_release);
+}
+
+ConcurrentPageTable::Bucket& ConcurrentPageTable::lockBucket(
+    const std::uint64_t key) {
+  while (true) {
+    Table* t = table.load(std::memory_order_acquire);
+    Bucket& bucket = t->buckets[hash(key, t->mask)];
+    lock(bucket);
+    if (!t->moved.load(std::memory_order_relaxed)) {
+      return bucket;
+    }
+    // resize() replaced the array while we waited for the lock
+    unlock(bucket);
+  }
+}
+
+bool ConcurrentPageTable::insert(const File& file, const PageId pageNo,
+                                 const FrameId frameNo) {
+  EpochGuard guard(epochs);
+  const std::uint64_t k = key(file, pageNo);
+  Bucket& bucket = lockBucket(k);
+  Node* head = bucket.head.load(std::memory_order_relaxed);
+  for (Node* n = head; n; n = n->next.load(std::memory_order_relaxed)) {
+    if (n->key == k) {
+      unlock(bucket);
+      return false;
+    }
+  }
+  // publish the node only once it is complete
+  bucket.head.store(new Node(k, frameNo, head), std::memory_order_release);
+  count.fetch_add(1, std::memory_order_relaxed);
+  unlock(bucket);
+  return true;
+}
+
+bool ConcurrentPageTable::remove(const File& file, const PageId pageNo) {
+  EpochGuard guard(epochs);
+  const std::uint64_t k = key(file, pageNo);
+  Bucket& bucket = lockBucket(k);
+  Node* removed = NULL;
+  for (std::atomic<Node*>* link = &bucket.head;;) {
+    Node* n = link->load(std::memory_order_relaxed);
+    if (!n) {
+      break;
+    }
+    if (n->key == k) {
+      // lookups standing on n still reach the rest of the chain through it
+      link->store(n->next.load(std::memory_order_relaxed),
+                  std::memory_order_release);
+      removed = n;
+      break;
+    }
+    link = &n->next;
+  }
+  unlock(bucket);
+  if (!removed) {
+    return false;
+  }
+  count.fetch_sub(1, std::memory_order_relaxed);
+  epochs.retire(removed);
+  return true;
+}
+
+void ConcurrentPageTable::resize(std::uint32_t buckets) {
+  std::lock_guard<std::mutex> resizing(resizeMutex);
+  EpochGuard guard(epochs);
+  Table* old = table.load(std::memory_order_relaxed);
+  Table* t = new Table(bucketsFor(buckets));
+  for (std::uint32_t i = 0; i <= old->mask; i++) {
+    lock(old->buckets[i]);
+  }
+
+  // lookups keep walking the old nodes, so the entries are copied
+  for (std::uint32_t i = 0; i <= old->mask; i++) {
+    for (Node* n = old->buckets[i].head.load(std::memory_order_relaxed); n;
+         n = n->next.load(std::memory_order_relaxed)) {
+      Bucket& bucket = t->buckets[hash(n->key, t->mask)];
+      bucket.head.store(
+          new Node(n->key, n->frameNo,
+                   bucket.head.load(std::memory_order_relaxed)),
+          std::memory_order_relaxed);
+    }
+  }
+  table.store(t, std::memory_order_release);
+  old->moved.store(true, std::memory_order_relaxed);
+
+  for (std::uint32_t i = 0; i <= old->mask; i++) {
+    unlock(old->buckets[i]);
+  }
+  epochs.retire(old);
+  // free what earlier resizes and removes left behind, whichever thread
+  // retired it
+  epochs.collect();
+}
+
+}  // namespace badgerdb
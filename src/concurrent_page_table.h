@@ -0,0 +1,196 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "epoch.h"
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Hash table from (file, page) to frame that many threads may use at
+ * once.
+ *
+ * Lookups take no lock and never retry: they walk a bucket's chain through
+ * atomic pointers and finish in as many steps as the chain is long, whatever
+ * other threads do.  Inserts and removes lock only their bucket, so they run
+ * alongside lookups and alongside each other on other buckets.  A node is
+ * unlinked without changing its own next pointer, so a lookup standing on it
+ * carries on along the chain, and it is freed through an EpochManager once
+ * no lookup can be standing on it.
+ *
+ * Keys are the file number in the upper and the page number in the lower 32
+ * bits, as in BufHashTbl.  resize() rebuilds the bucket array while lookups
+ * go on in the old one; updates wait for it.
+ */
+class ConcurrentPageTable {
+ public:
+  /**
+   * Constructor of ConcurrentPageTable class
+   *
+   * @param buckets   Minimum number of buckets; rounded up to a power of two
+   */
+  explicit ConcurrentPageTable(std::uint32_t buckets);
+
+  /**
+   * Frees all entries.  No other thread may use the table.
+   */
+  ~ConcurrentPageTable();
+
+  ConcurrentPageTable(const ConcurrentPageTable&) = delete;
+  ConcurrentPageTable& operator=(const ConcurrentPageTable&) = delete;
+
+  /**
+   * Returns the frame of (file, pageNo) if it is in the table.
+   *
+   * @param file   	File object
+   * @param pageNo	Page number in the file
+   * @param frameNo Frame number reference, set if the page is found
+   * @return        False if the page is not in the table
+   */
+  bool lookup(const File& file, const PageId pageNo, FrameId& frameNo) {
+    EpochGuard guard(epochs);
+    const std::uint64_t k = key(file, pageNo);
+    const Table* t = table.load(std::memory_order_acquire);
+    for (const Node* n = t->buckets[hash(k, t->mask)].head.load(
+             std::memory_order_acquire);
+         n; n = n->next.load(std::memory_order_acquire)) {
+      if (n->key == k) {
+        frameNo = n->frameNo;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Map (file, pageNo) to frameNo unless the page is already in the table.
+   *
+   * @param file   	File object
+   * @param pageNo 	Page number in the file
+   * @param frameNo Frame number assigned to that page of the file
+   * @return        False if the page is already in the table
+   */
+  bool insert(const File& file, const PageId pageNo, const FrameId frameNo);
+
+  /**
+   * Remove (file, pageNo) from the table if it is there.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @return        False if the page is not in the table
+   */
+  bool remove(const File& file, const PageId pageNo);
+
+  /**
+   * Change the number of buckets.  Lookups meanwhile use the old buckets;
+   * inserts and removes wait for the new ones.  Nodes and bucket arrays
+   * retired earlier that no lookup can reach any more are freed.
+   *
+   * @param buckets   Minimum number of buckets; rounded up to a power of two
+   */
+  void resize(std::uint32_t buckets);
+
+  /**
+   * Returns the number of entries.
+   */
+  std::uint32_t size() const { return count.load(std::memory_order_relaxed); }
+
+ private:
+  /**
+   * An entry.  Only next changes once the node is linked in.
+   */
+  struct Node {
+    Node(std::uint64_t key, FrameId frameNo, Node* next)
+        : key(key), frameNo(frameNo), next(next) {}
+
+    const std::uint64_t key;
+    const FrameId frameNo;
+    std::atomic<Node*> next;
+  };
+
+  /**
+   * Head of a chain, and the lock serializing updates of the chain.
+   */
+  struct Bucket {
+    Bucket() : head(NULL), locked(false) {}
+
+    std::atomic<Node*> head;
+    std::atomic<bool> locked;
+  };
+
+  /**
+   * A bucket array.  Replaced as a whole by resize().
+   */
+  struct Table {
+    explicit Table(std::uint32_t buckets)
+        : mask(buckets - 1), buckets(new Bucket[buckets]), moved(false) {}
+
+    /**
+     * Deletes the buckets and the nodes still linked into them.
+     */
+    ~Table();
+
+    /**
+     * Number of buckets minus one; the number of buckets is a power of two
+     */
+    const std::uint32_t mask;
+
+    Bucket* const buckets;
+
+    /**
+     * Set by resize() while it holds every bucket lock, once updates must go
+     * to the new array
+     */
+    std::atomic<bool> moved;
+  };
+
+  static std::uint64_t key(const File& file, const PageId pageNo) {
+    return (std::uint64_t(file.id()) << 32) | pageNo;
+  }
+
+  static std::uint32_t hash(const std::uint64_t key, std::uint32_t mask) {
+    return (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+  }
+
+  static void lock(Bucket& bucket);
+  static void unlock(Bucket& bucket);
+
+  /**
+   * Locks the bucket of a key in the current array, waiting out a resize.
+   * The caller must be inside an epoch guard.
+   */
+  Bucket& lockBucket(const std::uint64_t key);
+
+  /**
+   * Current bucket array
+   */
+  std::atomic<Table*> table;
+
+  /**
+   * Number of entries
+   */
+  std::atomic<std::uint32_t> count;
+
+  /**
+   * Serializes resize()
+   */
+  std::mutex resizeMutex;
+
+  /**
+   * Frees unlinked nodes and replaced bucket arrays
+   */
+  EpochManager epochs;
+};
+
+}  // namespace badgerdb
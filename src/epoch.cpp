@@ -0,0 +1,158 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "epoch.h"
+
+#include <unordered_map>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Source of EpochManager identifiers; 0 is never handed out.
+ */
+std::atomic<std::uint64_t> nextManagerId(1);
+
+}  // namespace
+
+const std::uint32_t EpochManager::COLLECT_INTERVAL;
+
+EpochManager::EpochManager() : id(nextManagerId++), epoch(1) {}
+
+EpochManager::~EpochManager() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& thread : threads) {
+    for (const Retired& r : thread->retired) {
+      r.deleter(r.object);
+    }
+    thread->retired.clear();
+  }
+}
+
+EpochManager::ThreadRecord& EpochManager::local() {
+  // Records of the managers this thread has used, marked as exited when the
+  // thread exits.  Entries are never removed, but a destroyed manager's
+  // identifier is never reused, so a stale entry is merely unused.
+  struct Records {
+    ~Records() {
+      for (auto& entry : byManager) {
+        entry.second->exited.store(true, std::memory_order_release);
+      }
+    }
+
+    std::unordered_map<std::uint64_t, std::shared_ptr<ThreadRecord>>
+        byManager;
+  };
+  thread_local Records mine;
+  thread_local std::uint64_t lastId = 0;
+  thread_local ThreadRecord* last = NULL;
+
+  if (lastId != id) {
+    std::shared_ptr<ThreadRecord>& record = mine.byManager[id];
+    if (!record) {
+      record = std::make_shared<ThreadRecord>();
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.push_back(record);
+    }
+    lastId = id;
+    last = record.get();
+  }
+  return *last;
+}
+
+void EpochManager::enter() {
+  ThreadRecord& record = local();
+  if (record.depth++ > 0) {
+    return;
+  }
+  const std::uint64_t e = epoch.load(std::memory_order_relaxed);
+  record.state.store((e << 1) | 1, std::memory_order_relaxed);
+  // the announcement must be visible before any shared pointer is read
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void EpochManager::exit() {
+  ThreadRecord& record = local();
+  if (--record.depth > 0) {
+    return;
+  }
+  record.state.store(0, std::memory_order_release);
+}
+
+void EpochManager::retire(void* object, void (*deleter)(void*)) {
+  ThreadRecord& record = local();
+  // a read-modify-write sees the latest epoch, so the object is not tagged
+  // with an epoch older than the one it was unlinked in
+  const std::uint64_t e = epoch.fetch_add(0, std::memory_order_seq_cst);
+  {
+    std::lock_guard<std::mutex> lock(record.retiredMutex);
+    record.retired.push_back(Retired{object, deleter, e});
+  }
+  if (++record.sinceCollect >= COLLECT_INTERVAL) {
+    collect();
+  }
+}
+
+void EpochManager::tryAdvance() {
+  std::uint64_t e = epoch.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& thread : threads) {
+      const std::uint64_t state = thread->state.load(std::memory_order_acquire);
+      if ((state & 1) && (state >> 1) != e) {
+        return;
+      }
+    }
+  }
+  epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel);
+}
+
+void EpochManager::collect() {
+  ThreadRecord& record = local();
+  record.sinceCollect = 0;
+  tryAdvance();
+
+  // readers inside a guard have observed at least epoch - 1, so objects
+  // retired before that can no longer be reached
+  const std::uint64_t e = epoch.load(std::memory_order_acquire);
+  std::vector<Retired> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t t = 0; t < threads.size();) {
+      ThreadRecord& thread = *threads[t];
+      // read before the list, so an exited thread's last retire() is seen
+      bool done = thread.exited.load(std::memory_order_acquire);
+      {
+        std::lock_guard<std::mutex> retiredLock(thread.retiredMutex);
+        std::size_t freed = 0;
+        while (freed < thread.retired.size() &&
+               thread.retired[freed].epoch + 2 <= e) {
+          ready.push_back(thread.retired[freed]);
+          freed++;
+        }
+        thread.retired.erase(thread.retired.begin(),
+                             thread.retired.begin() + freed);
+        done = done && thread.retired.empty();
+      }
+      // the record may be the last reference to it
+      if (done) {
+        threads[t] = threads.back();
+        threads.pop_back();
+      } else {
+        t++;
+      }
+    }
+  }
+  for (const Retired& r : ready) {
+    r.deleter(r.object);
+  }
+}
+
+}  // namespace badgerdb
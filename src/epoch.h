@@ -0,0 +1,202 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Epoch based reclamation of memory shared by lock-free readers.
+ *
+ * Readers bracket their accesses with enter() and exit(), usually through an
+ * EpochGuard.  Writers that unlink an object from a shared structure hand it
+ * to retire() instead of deleting it; it is deleted once every thread that
+ * could still hold a pointer to it has left the epoch it was retired in.
+ *
+ * A global epoch advances when every thread inside a guard has observed the
+ * current one.  An object retired in epoch e may be freed once the epoch
+ * reaches e + 2, by whichever thread collects next: every thread collects
+ * after COLLECT_INTERVAL retire() calls, and collect() frees the objects of
+ * all threads, including ones that have stopped using the manager.  A thread
+ * that exits is unregistered once its objects have been freed.
+ *
+ * The class is threadsafe.  Guards may be nested.
+ */
+class EpochManager {
+ public:
+  /**
+   * Constructor of EpochManager class
+   */
+  EpochManager();
+
+  /**
+   * Frees every retired object.  No thread may be inside a guard.
+   */
+  ~EpochManager();
+
+  EpochManager(const EpochManager&) = delete;
+  EpochManager& operator=(const EpochManager&) = delete;
+
+  /**
+   * Start reading shared objects.
+   */
+  void enter();
+
+  /**
+   * Stop reading shared objects; pointers read since enter() must not be
+   * used any more.
+   */
+  void exit();
+
+  /**
+   * Schedule an object that is no longer reachable for deletion.
+   *
+   * @param object    Object to delete
+   * @param deleter   Function deleting it
+   */
+  void retire(void* object, void (*deleter)(void*));
+
+  /**
+   * Schedule an object allocated with new that is no longer reachable for
+   * deletion.
+   *
+   * @param object    Object to delete
+   */
+  template <typename T>
+  void retire(T* object) {
+    retire(object, [](void* p) { delete static_cast<T*>(p); });
+  }
+
+  /**
+   * Advance the epoch if possible and free the retired objects of every
+   * thread that no reader can hold any more.
+   */
+  void collect();
+
+ private:
+  /**
+   * Number of retire() calls of a thread between two collect() calls
+   */
+  static const std::uint32_t COLLECT_INTERVAL = 64;
+
+  /**
+   * An object waiting to be freed.
+   */
+  struct Retired {
+    void* object;
+    void (*deleter)(void*);
+
+    /**
+     * Epoch the object was retired in
+     */
+    std::uint64_t epoch;
+  };
+
+  /**
+   * State of one thread.
+   */
+  struct ThreadRecord {
+    ThreadRecord() : state(0), exited(false), depth(0), sinceCollect(0) {}
+
+    /**
+     * Epoch observed on entering shifted left by one with the low bit set,
+     * or 0 outside of any guard.  Written by the owning thread only.
+     */
+    std::atomic<std::uint64_t> state;
+
+    /**
+     * Set when the thread exits
+     */
+    std::atomic<bool> exited;
+
+    /**
+     * Number of guards the thread is inside
+     */
+    int depth;
+
+    /**
+     * Guards retired
+     */
+    std::mutex retiredMutex;
+
+    /**
+     * Objects retired by the thread, oldest first
+     */
+    std::vector<Retired> retired;
+
+    /**
+     * Number of retire() calls since the last collect()
+     */
+    std::uint32_t sinceCollect;
+  };
+
+  /**
+   * Returns the calling thread's record, registering it on first use.
+   */
+  ThreadRecord& local();
+
+  /**
+   * Advance the epoch if every thread inside a guard has observed it.
+   */
+  void tryAdvance();
+
+  /**
+   * Identifies this manager in the per-thread record caches
+   */
+  const std::uint64_t id;
+
+  /**
+   * Global epoch, starting at 1
+   */
+  std::atomic<std::uint64_t> epoch;
+
+  /**
+   * Guards threads
+   */
+  std::mutex mutex;
+
+  /**
+   * Record of every thread that used the manager and has not exited, or has
+   * retired objects not yet freed
+   */
+  std::vector<std::shared_ptr<ThreadRecord>> threads;
+};
+
+/**
+ * @brief Keeps the calling thread inside an epoch for its lifetime.
+ */
+class EpochGuard {
+ public:
+  /**
+   * Enters the epoch of a manager.
+   *
+   * @param epochs  Manager to enter
+   */
+  explicit EpochGuard(EpochManager& epochs) : epochs(epochs) {
+    epochs.enter();
+  }
+
+  /**
+   * Leaves the epoch.
+   */
+  ~EpochGuard() { epochs.exit(); }
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+ private:
+  EpochManager& epochs;
+};
+
+}  // namespace badgerdb
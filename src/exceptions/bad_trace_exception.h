@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a buffer access trace cannot be
+ *        written, or is not a trace.
+ */
+class BadTraceException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad trace exception for the given trace file.
+   *
+   * @param name    Name of the trace file.
+   * @param reason  What is wrong with it.
+   */
+  BadTraceException(const std::string &name, const std::string &reason);
+
+  /**
+   * Returns the name of the trace file that caused this exception.
+   */
+  virtual const std::string &filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of the trace file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,24 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "file_io_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+FileIOException::FileIOException(const std::string &name,
+                                 const std::string &reason)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "I/O error on file " << filename_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}  // namespace badgerdb
@@ -8,14 +8,29 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
-#include <fstream>
-#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
@@ -24,15 +39,147 @@
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+static_assert(Page::SIZE % File::DIRECT_ALIGNMENT == 0,
+              "Pages must be whole blocks of direct I/O.");
+
+namespace {
+
+/**
+ * Page-sized blocks of memory aligned for direct I/O, for the pages and
+ * headers that do not already lie in aligned memory.
+ */
+class AlignedPages {
+ public:
+  explicit AlignedPages(std::size_t count) : data_(NULL) {
+    if (::posix_memalign(&data_, File::DIRECT_ALIGNMENT, count * Page::SIZE) !=
+        0) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~AlignedPages() { std::free(data_); }
+
+  AlignedPages(const AlignedPages &) = delete;
+  AlignedPages &operator=(const AlignedPages &) = delete;
+
+  char *page(std::size_t i) {
+    return static_cast<char *>(data_) + i * Page::SIZE;
+  }
+
+ private:
+  void *data_;
+};
+
+bool isAligned(const void *p) {
+  return reinterpret_cast<std::uintptr_t>(p) % File::DIRECT_ALIGNMENT == 0;
+}
+
+/**
+ * Lays out a page as it is on disk, header first, at dest.
+ */
+void copyPage(char *dest, const PageHeader &header, const char *data) {
+  std::memcpy(dest, &header, sizeof(PageHeader));
+  std::memcpy(dest + sizeof(PageHeader), data, Page::DATA_SIZE);
+}
+
+/**
+ * Reads size bytes at offset, retrying reads that are interrupted or cut
+ * short.
+ */
+void readAt(const int fd, void *buf, std::size_t size, off_t offset,
+            const std::string &filename) {
+  char *next = static_cast<char *>(buf);
+  while (size > 0) {
+    const ssize_t n = ::pread(fd, next, size, offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename, std::strerror(errno));
+    }
+    if (n == 0) {
+      throw FileIOException(filename, "read past the end of the file");
+    }
+    next += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+/**
+ * Advances iov past the given number of bytes of its buffers.
+ */
+void skip(iovec *&iov, int &count, std::size_t bytes) {
+  while (count > 0 && bytes >= iov->iov_len) {
+    bytes -= iov->iov_len;
+    ++iov;
+    --count;
+  }
+  if (count > 0) {
+    iov->iov_base = static_cast<char *>(iov->iov_base) + bytes;
+    iov->iov_len -= bytes;
+  }
+}
+
+/**
+ * Writes the buffers of iov one after the other at offset, retrying writes
+ * that are interrupted or cut short.  Advances iov past what was written.
+ */
+void writeAt(const int fd, iovec *iov, int count, off_t offset,
+             const std::string &filename) {
+  while (count > 0) {
+    const ssize_t n = ::pwritev(fd, iov, std::min(count, IOV_MAX), offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename, std::strerror(errno));
+    }
+    offset += n;
+    skip(iov, count, n);
+  }
+}
+
+/**
+ * Waits for a request and finishes it synchronously if the engine
+ * transferred less than all of it.
+ */
+void finish(IoEngine &io, IoRequest &request, const std::string &filename) {
+  io.wait(request);
+  if (request.result < 0) {
+    throw FileIOException(filename, std::strerror(-request.result));
+  }
+  iovec *iov = request.iov;
+  int count = request.iovcnt;
+  skip(iov, count, request.result);
+  off_t offset = request.offset + request.result;
+  if (request.write) {
+    writeAt(request.fd, iov, count, offset, filename);
+    return;
+  }
+  for (; count > 0; ++iov, --count) {
+    readAt(request.fd, iov->iov_base, iov->iov_len, offset, filename);
+    offset += iov->iov_len;
+  }
+}
+
+}  // namespace
+
+File::DescriptorMap File::open_files_;
 File::CountMap File::open_counts_;
+File::IdMap File::file_ids_;
+std::mutex File::open_mutex_;
 
-File File::create(const std::string &filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string &filename, const bool direct) {
+  return File(filename, true /* create_new */, direct ? DIRECT : BUFFERED);
 }
 
-File File::open(const std::string &filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string &filename, const bool direct) {
+  return File(filename, false /* create_new */, direct ? DIRECT : BUFFERED);
+}
+
+File File::openMapped(const std::string &filename) {
+  return File(filename, false /* create_new */, MAPPED);
 }
 
 void File::remove(const std::string &filename) {
@@ -42,30 +189,25 @@ void File::remove(const std::string &filename) {
   if (isOpen(filename)) {
     throw FileOpenException(filename);
   }
-  std::remove(filename.c_str());
+  ::unlink(filename.c_str());
 }
 
 bool File::isOpen(const std::string &filename) {
   if (!exists(filename)) {
     return false;
   }
+  std::lock_guard<std::mutex> lock(open_mutex_);
   return open_counts_.find(filename) != open_counts_.end();
 }
 
 bool File::exists(const std::string &filename) {
-  std::fstream file(filename);
-  if (file) {
-    file.close();
-    return true;
-  }
-
-  return false;
+  return ::access(filename.c_str(), F_OK) == 0;
 }
 
 File::File(const File &other)
-    : filename_(other.filename_),
-      stream_(open_streams_[filename_]),
-      valid_(other.valid_) {
+    : filename_(other.filename_), id_(other.id_), valid_(other.valid_) {
+  std::lock_guard<std::mutex> lock(open_mutex_);
+  descriptor_ = open_files_[filename_];
   ++open_counts_[filename_];
 }
 
@@ -74,54 +216,68 @@ File &File::operator=(const File &rhs) {
   // same file.
   close();  // close my file and associate me with the new one
   filename_ = rhs.filename_;
+  id_ = rhs.id_;
   valid_ = rhs.valid_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */,
+               rhs.descriptor_ ? rhs.descriptor_->mode : BUFFERED);
   return *this;
 }
 
 File::~File() { close(); }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
+  // Page() leaves the data empty, as it is on a new page.
   Page new_page;
+  new_page.header_ = allocatePageHeader();
+  return new_page;
+}
+
+PageHeader File::allocatePageHeader() {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+  FileHeader header = readHeader();
+  PageHeader new_page = Page::emptyHeader();
   Page existing_page;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    // Free pages are cleared when they are deleted, so only the link to the
+    // next free page needs to be read.
+    new_page.current_page_number = header.first_free_page;
+    header.first_free_page =
+        readPageHeader(new_page.current_page_number).next_page_number;
     --header.num_free_pages;
+    descriptor_->free_pages.erase(new_page.current_page_number);
 
     if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
+        header.first_used_page > new_page.current_page_number) {
       // Either have no pages used or the head of the used list is a page
       // later than the one we just allocated, so add the new page to the
       // head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
+      if (header.first_used_page > new_page.current_page_number) {
+        new_page.next_page_number = header.first_used_page;
       }
-      header.first_used_page = new_page.page_number();
+      header.first_used_page = new_page.current_page_number;
     } else {
       // New page is reused from somewhere after the beginning, so we need
       // to find where in the used list to insert it.
       PageId next_page_number = Page::INVALID_NUMBER;
       for (FileIterator iter = begin(); iter != end(); ++iter) {
         next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
+        if (next_page_number > new_page.current_page_number ||
             next_page_number == Page::INVALID_NUMBER) {
           existing_page = *iter;
           break;
         }
       }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
+      existing_page.set_next_page_number(new_page.current_page_number);
+      new_page.next_page_number = next_page_number;
     }
 
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
-    new_page.set_page_number(header.num_pages);
+    new_page.current_page_number = header.num_pages;
     if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
+      header.first_used_page = new_page.current_page_number;
     } else {
       // If we have pages allocated, we need to add the new page to the
       // tail of the linked list.
@@ -132,15 +288,21 @@ Page File::allocatePage() {
         }
       }
       assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+      existing_page.set_next_page_number(new_page.current_page_number);
     }
     ++header.num_pages;
   }
-  writePage(new_page.page_number(), new_page);
+  // Every new page has the same empty data.
+  static const Page empty_page;
+  writePage(new_page.current_page_number, new_page, empty_page);
+  descriptor_->next_pages[new_page.current_page_number] =
+      new_page.next_page_number;
   if (existing_page.page_number() != Page::INVALID_NUMBER) {
     // If we updated an existing page by inserting the new page into the
     // used list, we need to write it out.
     writePage(existing_page.page_number(), existing_page);
+    descriptor_->next_pages[existing_page.page_number()] =
+        existing_page.next_page_number();
   }
   writeHeader(header);
 
@@ -148,41 +310,214 @@ Page File::allocatePage() {
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
+  Page page;
+  readPage(page_number, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page &dest) const {
+  if (page_number >= descriptor_->num_pages.load(std::memory_order_acquire)) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  readPage(page_number, false /* allow_free */, dest);
 }
 
-Page File::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
+void File::readPage(const PageId page_number, const bool allow_free,
+                    Page &dest) const {
+  // header_ comes first, as on disk, so the page is read in one go
+  static_assert(offsetof(Page, header_) == 0,
+                "Page header must be at the start of the page.");
+  if (isMapped()) {
+    std::memcpy(static_cast<void *>(&dest),
+                mappedAt(pagePosition(page_number), Page::SIZE), Page::SIZE);
+  } else if (isDirect() && !isAligned(&dest)) {
+    std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+    readAt(descriptor_->fd, descriptor_->scratch, Page::SIZE,
+           pagePosition(page_number), filename_);
+    std::memcpy(static_cast<void *>(&dest), descriptor_->scratch, Page::SIZE);
+  } else {
+    readAt(descriptor_->fd, &dest, Page::SIZE, pagePosition(page_number),
+           filename_);
+  }
+  if (!allow_free && !dest.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+}
 
+const Page *File::mappedPage(const PageId page_number) const {
+  if (!isMapped()) {
+    throw FileIOException(filename_, "file is not mapped");
+  }
+  if (page_number >= descriptor_->num_pages.load(std::memory_order_acquire)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page *page = reinterpret_cast<const Page *>(
+      mappedAt(pagePosition(page_number), Page::SIZE));
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
   return page;
 }
 
 void File::writePage(const Page &new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
-    // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+  writePage(new_page.page_number(), headerToWrite(new_page), new_page);
+}
+
+void File::readPages(IoEngine &io, const std::vector<PageId> &page_numbers,
+                     const std::vector<Page *> &dests,
+                     std::vector<std::exception_ptr> &errors) const {
+  errors.assign(page_numbers.size(), std::exception_ptr());
+  const PageId num_pages =
+      descriptor_->num_pages.load(std::memory_order_acquire);
+  std::vector<iovec> iovs(page_numbers.size());
+  std::vector<IoRequest> requests(page_numbers.size());
+  std::vector<IoRequest *> submitted;
+  // Pages of a mapped file are copied out of the mapping, and direct reads
+  // into unaligned pages go through a copy, after the others.
+  std::vector<bool> copied(page_numbers.size());
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    if (page_numbers[i] >= num_pages) {
+      errors[i] = std::make_exception_ptr(
+          InvalidPageException(page_numbers[i], filename_));
+      continue;
+    }
+    if (isMapped() || (isDirect() && !isAligned(dests[i]))) {
+      copied[i] = true;
+      continue;
+    }
+    iovs[i] = iovec{dests[i], Page::SIZE};
+    requests[i].fd = descriptor_->fd;
+    requests[i].offset = pagePosition(page_numbers[i]);
+    requests[i].iov = &iovs[i];
+    requests[i].iovcnt = 1;
+    submitted.push_back(&requests[i]);
+  }
+  io.submit(submitted);
+
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    if (errors[i]) {
+      continue;
+    }
+    try {
+      if (copied[i]) {
+        readPage(page_numbers[i], false /* allow_free */, *dests[i]);
+        continue;
+      }
+      finish(io, requests[i], filename_);
+      if (!dests[i]->isUsed()) {
+        throw InvalidPageException(page_numbers[i], filename_);
+      }
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  }
+}
+
+void File::writePages(const std::vector<const Page *> &pages) {
+  writePages(pages, NULL);
+}
+
+void File::writePages(IoEngine &io, const std::vector<const Page *> &pages) {
+  writePages(pages, &io);
+}
+
+void File::writePages(const std::vector<const Page *> &pages, IoEngine *io) {
+  checkWritable();
+  std::vector<const Page *> sorted(pages);
+  std::sort(sorted.begin(), sorted.end(), [](const Page *a, const Page *b) {
+    return a->page_number() < b->page_number();
+  });
+
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+  // Check every page before writing any of them, and keep the next page
+  // pointers on disk as writePage() does.
+  std::vector<PageHeader> headers;
+  headers.reserve(sorted.size());
+  for (const Page *page : sorted) {
+    headers.push_back(headerToWrite(*page));
+  }
+
+  // Pages lie on disk header first, so a run of pages with consecutive
+  // numbers is one write gathering each page's header and data.  Direct I/O
+  // needs aligned memory, so there the run is copied into an aligned buffer
+  // instead.  Through an engine, the runs are written at once, in pieces of
+  // at most IOV_MAX buffers.
+  std::vector<iovec> iovs;
+  iovs.reserve(2 * sorted.size());
+  std::vector<std::unique_ptr<AlignedPages>> copies;
+  std::vector<IoRequest> requests;
+  requests.reserve(sorted.size());
+  std::size_t start = 0;
+  while (start < sorted.size()) {
+    const std::size_t first_iov = iovs.size();
+    std::size_t end = start + 1;
+    while (end < sorted.size() &&
+           sorted[end]->page_number() == sorted[end - 1]->page_number() + 1) {
+      ++end;
+    }
+    if (isDirect()) {
+      copies.emplace_back(new AlignedPages(end - start));
+      for (std::size_t j = start; j < end; ++j) {
+        copyPage(copies.back()->page(j - start), headers[j],
+                 &sorted[j]->data_[0]);
+      }
+      iovs.push_back(iovec{copies.back()->page(0), (end - start) * Page::SIZE});
+    } else {
+      for (std::size_t j = start; j < end; ++j) {
+        iovs.push_back(iovec{&headers[j], sizeof(PageHeader)});
+        iovs.push_back(
+            iovec{const_cast<char *>(&sorted[j]->data_[0]), Page::DATA_SIZE});
+      }
+    }
+    off_t offset = pagePosition(sorted[start]->page_number());
+    if (!io) {
+      writeAt(descriptor_->fd, &iovs[first_iov], iovs.size() - first_iov,
+              offset, filename_);
+    } else {
+      for (std::size_t k = first_iov; k < iovs.size(); k += IOV_MAX) {
+        IoRequest request;
+        request.write = true;
+        request.fd = descriptor_->fd;
+        request.offset = offset;
+        request.iov = &iovs[k];
+        request.iovcnt = std::min<std::size_t>(IOV_MAX, iovs.size() - k);
+        for (int m = 0; m < request.iovcnt; ++m) {
+          offset += iovs[k + m].iov_len;
+        }
+        requests.push_back(request);
+      }
+    }
+    start = end;
+  }
+  if (!io) {
+    return;
+  }
+
+  std::vector<IoRequest *> submitted;
+  for (IoRequest &request : requests) {
+    submitted.push_back(&request);
+  }
+  io->submit(submitted);
+  std::exception_ptr error;
+  for (IoRequest &request : requests) {
+    try {
+      finish(*io, request, filename_);
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
 }
 
 void File::deletePage(const PageId page_number) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
   FileHeader header = readHeader();
   Page existing_page = readPage(page_number);
   Page previous_page;
@@ -207,8 +542,12 @@ void File::deletePage(const PageId page_number) {
   ++header.num_free_pages;
   if (previous_page.isUsed()) {
     writePage(previous_page.page_number(), previous_page);
+    descriptor_->next_pages[previous_page.page_number()] =
+        previous_page.next_page_number();
   }
   writePage(page_number, existing_page);
+  descriptor_->next_pages[page_number] = existing_page.next_page_number();
+  descriptor_->free_pages.insert(page_number);
   writeHeader(header);
 }
 
@@ -219,9 +558,24 @@ FileIterator File::begin() {
 
 FileIterator File::end() { return FileIterator(this, Page::INVALID_NUMBER); }
 
-File::File(const std::string &name, const bool create_new)
-    : filename_(name), valid_(true) {
-  openIfNeeded(create_new);
+void File::advise(const FileAccess access) const {
+  if (isMapped()) {
+    const int advice = access == FileAccess::SEQUENTIAL ? MADV_SEQUENTIAL
+                       : access == FileAccess::RANDOM   ? MADV_RANDOM
+                                                        : MADV_NORMAL;
+    ::madvise(const_cast<char *>(descriptor_->mapping),
+              descriptor_->mapping_size, advice);
+  } else {
+    const int advice = access == FileAccess::SEQUENTIAL ? POSIX_FADV_SEQUENTIAL
+                       : access == FileAccess::RANDOM   ? POSIX_FADV_RANDOM
+                                                        : POSIX_FADV_NORMAL;
+    ::posix_fadvise(descriptor_->fd, 0, 0 /* to the end */, advice);
+  }
+}
+
+File::File(const std::string &name, const bool create_new, const Mode mode)
+    : filename_(name), id_(0), valid_(true) {
+  openIfNeeded(create_new, mode);
 
   if (create_new) {
     // File starts with 1 page (the header).
@@ -231,14 +585,18 @@ File::File(const std::string &name, const bool create_new)
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const Mode mode) {
+  std::lock_guard<std::mutex> lock(open_mutex_);
   if (open_counts_.find(filename_) !=
       open_counts_.end()) {  // exists an entry already
+    if (open_files_[filename_]->mode != mode) {
+      valid_ = false;
+      throw FileIOException(filename_, "file is already open in another mode");
+    }
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    descriptor_ = open_files_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = (mode == MAPPED ? O_RDONLY : O_RDWR) | O_CLOEXEC;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -246,7 +604,7 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
@@ -254,17 +612,71 @@ void File::openIfNeeded(const bool create_new) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    if (mode == DIRECT) {
+#ifdef O_DIRECT
+      flags |= O_DIRECT;
+#else
+      valid_ = false;
+      throw FileIOException(filename_, "direct I/O is not supported");
+#endif
+    }
+    const int fd = ::open(filename_.c_str(), flags, 0666);
+    if (fd < 0) {
+      valid_ = false;
+      throw FileIOException(filename_, std::strerror(errno));
+    }
+    // A new file is laid out for direct I/O only if it is opened for it; an
+    // existing one was if the header takes up a whole page.
+    bool aligned = mode == DIRECT;
+    if (!create_new) {
+      struct stat status;
+      if (::fstat(fd, &status) != 0) {
+        const int error = errno;
+        ::close(fd);
+        valid_ = false;
+        throw FileIOException(filename_, std::strerror(error));
+      }
+      aligned = status.st_size % Page::SIZE == 0;
+    }
+    if (mode == DIRECT && !aligned) {
+      ::close(fd);
+      valid_ = false;
+      throw FileIOException(filename_, "file is not laid out for direct I/O");
+    }
+    std::shared_ptr<Descriptor> descriptor =
+        std::make_shared<Descriptor>(fd, mode, aligned);
+    if (mode == MAPPED) {
+      try {
+        descriptor->map(filename_);
+      } catch (...) {
+        valid_ = false;
+        throw;
+      }
+    }
+    descriptor_ = descriptor;
+    if (!create_new) {
+      try {
+        loadHeader();
+      } catch (...) {
+        descriptor_.reset();
+        valid_ = false;
+        throw;
+      }
+    }
+    open_files_[filename_] = descriptor_;
     open_counts_[filename_] = 1;
   }
+  if (valid_) {
+    id_ = file_ids_.emplace(filename_, file_ids_.size() + 1).first->second;
+  }
 }
 
 void File::close() {
+  std::lock_guard<std::mutex> lock(open_mutex_);
   --open_counts_[filename_];
-  stream_.reset();
+  descriptor_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_files_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
@@ -275,32 +687,157 @@ void File::writePage(const PageId page_number, const Page &new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader &header,
                      const Page &new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  if (isDirect()) {
+    std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+    copyPage(descriptor_->scratch, header, &new_page.data_[0]);
+    iovec iov = {descriptor_->scratch, Page::SIZE};
+    writeAt(descriptor_->fd, &iov, 1, pagePosition(page_number), filename_);
+    return;
+  }
+  iovec iov[] = {
+      {const_cast<PageHeader *>(&header), sizeof(header)},
+      {const_cast<char *>(&new_page.data_[0]), Page::DATA_SIZE}};
+  writeAt(descriptor_->fd, iov, 2, pagePosition(page_number), filename_);
+}
+
+PageHeader File::headerToWrite(const Page &page) const {
+  const PageId page_number = page.page_number();
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= descriptor_->header.num_pages ||
+      descriptor_->free_pages.count(page_number) != 0) {
+    // Page has been deleted since it was read.
+    throw InvalidPageException(page_number, filename_);
+  }
+  // Page on disk may have had its next page pointer updated since it was read;
+  // we don't modify that, but we do keep all the other modifications to the
+  // page header.
+  PageHeader header = page.header_;
+  const auto next = descriptor_->next_pages.find(page_number);
+  if (next != descriptor_->next_pages.end()) {
+    header.next_page_number = next->second;
+  }
+  return header;
 }
 
 FileHeader File::readHeader() const {
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+  return descriptor_->header;
+}
+
+void File::loadHeader() {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (isMapped()) {
+    std::memcpy(&header, mappedAt(0 /* pos */, sizeof(header)), sizeof(header));
+  } else if (isDirect()) {
+    std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+    readAt(descriptor_->fd, descriptor_->scratch, Page::SIZE, 0 /* pos */,
+           filename_);
+    std::memcpy(&header, descriptor_->scratch, sizeof(header));
+  } else {
+    readAt(descriptor_->fd, &header, sizeof(header), 0 /* pos */, filename_);
+  }
+  descriptor_->header = header;
+  descriptor_->num_pages.store(header.num_pages, std::memory_order_release);
 
-  return header;
+  PageId free_page = header.first_free_page;
+  for (PageId i = 0; i < header.num_free_pages; ++i) {
+    descriptor_->free_pages.insert(free_page);
+    free_page = readPageHeader(free_page).next_page_number;
+  }
 }
 
 void File::writeHeader(const FileHeader &header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+  if (isDirect()) {
+    // The whole of page 0 is written, so the file always ends on a page
+    // boundary and the header can be read with direct I/O.
+    std::memset(descriptor_->scratch, 0, Page::SIZE);
+    std::memcpy(descriptor_->scratch, &header, sizeof(header));
+    iovec iov = {descriptor_->scratch, Page::SIZE};
+    writeAt(descriptor_->fd, &iov, 1, 0 /* pos */, filename_);
+  } else {
+    iovec iov = {const_cast<FileHeader *>(&header), sizeof(header)};
+    writeAt(descriptor_->fd, &iov, 1, 0 /* pos */, filename_);
+  }
+  descriptor_->header = header;
+  descriptor_->num_pages.store(header.num_pages, std::memory_order_release);
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (isMapped()) {
+    std::memcpy(&header,
+                mappedAt(pagePosition(page_number), sizeof(header)),
+                sizeof(header));
+  } else if (isDirect()) {
+    std::lock_guard<std::recursive_mutex> lock(descriptor_->mutex);
+    readAt(descriptor_->fd, descriptor_->scratch, Page::SIZE,
+           pagePosition(page_number), filename_);
+    std::memcpy(&header, descriptor_->scratch, sizeof(header));
+  } else {
+    readAt(descriptor_->fd, &header, sizeof(header), pagePosition(page_number),
+           filename_);
+  }
 
   return header;
 }
 
+void File::checkWritable() const {
+  if (isMapped()) {
+    throw FileIOException(filename_, "file is mapped read-only");
+  }
+}
+
+const char *File::mappedAt(const off_t offset, const std::size_t size) const {
+  if (offset < 0 || std::size_t(offset) > descriptor_->mapping_size ||
+      size > descriptor_->mapping_size - offset) {
+    throw FileIOException(filename_, "read past the end of the file");
+  }
+  return descriptor_->mapping + offset;
+}
+
+File::Descriptor::Descriptor(const int fd, const Mode mode, const bool aligned)
+    : fd(fd),
+      mode(mode),
+      aligned(aligned),
+      scratch(NULL),
+      header(),
+      num_pages(0),
+      mapping(NULL),
+      mapping_size(0) {
+  if (mode == DIRECT) {
+    void *block = NULL;
+    if (::posix_memalign(&block, DIRECT_ALIGNMENT, Page::SIZE) != 0) {
+      ::close(fd);
+      throw std::bad_alloc();
+    }
+    scratch = static_cast<char *>(block);
+  }
+}
+
+File::Descriptor::~Descriptor() {
+  if (mapping) {
+    ::munmap(const_cast<char *>(mapping), mapping_size);
+  }
+  std::free(scratch);
+  ::close(fd);
+}
+
+void File::Descriptor::map(const std::string &filename) {
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    throw FileIOException(filename, std::strerror(errno));
+  }
+  if (status.st_size < off_t(sizeof(FileHeader))) {
+    throw FileIOException(filename, "file is too short to have a header");
+  }
+  void *start =
+      ::mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0 /* pos */);
+  if (start == MAP_FAILED) {
+    throw FileIOException(filename, std::strerror(errno));
+  }
+  mapping = static_cast<const char *>(start);
+  mapping_size = status.st_size;
+}
+
 }  // namespace badgerdb
@@ -8,17 +8,46 @@
 
 #pragma once
 
-#include <fstream>
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "io_engine.h"
 #include "page.h"
 
 namespace badgerdb {
 
 class FileIterator;
 
+/**
+ * @brief How a file's pages are about to be accessed, see File::advise().
+ */
+enum class FileAccess {
+  /**
+   * No particular order
+   */
+  NORMAL,
+
+  /**
+   * In increasing page number order, so read ahead aggressively
+   */
+  SEQUENTIAL,
+
+  /**
+   * In no predictable order, so do not read ahead
+   */
+  RANDOM,
+};
+
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
@@ -60,41 +89,98 @@ struct FileHeader {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the same
+ * underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the
- * File class detects this (by looking in the open_streams_ map) and just
- * returns a file object with the already created stream for the file without
- * actually opening the UNIX file again.
+ * File class detects this (by looking in the open_files_ map) and just
+ * returns a file object with the already opened descriptor for the file
+ * without actually opening the UNIX file again.
  *
- * @warning This class is not threadsafe.
+ * Pages are read and written with positional I/O, one system call per page
+ * or per run of consecutive pages, so there is no shared file offset and
+ * reads take no lock.  The file header, the set of free pages and the next
+ * page pointers changed since the file was opened are kept with the
+ * descriptor, so reads and writes are checked against them without any
+ * further I/O.  Changes to them are serialized by a mutex shared with the
+ * descriptor.  The open_files_ and open_counts_ maps are guarded by
+ * open_mutex_.  File objects (including copies held by the buffer manager)
+ * may therefore be used from multiple threads, but a page should not be read
+ * while it is being written, and a single File object should not be assigned
+ * to while another thread is using it.
+ *
+ * A file may be opened for direct I/O, which bypasses the operating system's
+ * page cache so that the buffer pool is the only cache of its pages.  A file
+ * created for direct I/O gives its header the whole of page 0, so every page
+ * lies at a multiple of Page::SIZE in the file, as direct I/O requires of
+ * offsets and lengths; other files put page 1 straight after the header.
+ * The layout of an existing file is told from its length, so either kind may
+ * be opened without direct I/O, but only the first kind with it.  Pages read
+ * into or written from memory aligned to DIRECT_ALIGNMENT, such as the buffer
+ * pool's frames, go straight between that memory and the disk; other pages,
+ * and the page and file headers, pass through an aligned copy.
+ *
+ * A file may instead be opened read-only and mapped into memory with
+ * openMapped().  Its pages are then read with no system calls, and
+ * mappedPage() hands out pointers to them in the mapping, so a scan with a
+ * FileIterator neither copies pages nor leaves user space.
  */
 class File {
  public:
+  /**
+   * Alignment of the memory that pages of a file opened for direct I/O are
+   * read into and written from without a copy.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param direct    Whether to do direct I/O on the file, bypassing the
+   *                  operating system's page cache.
    * @throws  FileExistsException     If the requested file already exists.
+   * @throws  FileIOException         If the file cannot be created, or the
+   *                                  filesystem does not do direct I/O.
    */
-  static File create(const std::string &filename);
+  static File create(const std::string &filename, const bool direct = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
    * It first checks if the file is already open. If so, then the new File
-   * object created uses the same input-output stream to read to or write fom
-   * that already open file. Reference count (open_counts_ static variable
-   * inside the File object) is incremented whenever an already open file is
-   * opened again. Otherwise the UNIX file is actually opened. The fileName and
-   * the stream associated with this File object are inserted into the
-   * open_streams_ map.
+   * object created uses the same descriptor to read to or write fom that
+   * already open file. Reference count (open_counts_ static variable inside
+   * the File object) is incremented whenever an already open file is opened
+   * again. Otherwise the UNIX file is actually opened. The fileName and the
+   * descriptor associated with this File object are inserted into the
+   * open_files_ map.  A file that is already open must be opened again in
+   * the mode it was opened in.
    *
    * @param filename  Name of the file.
+   * @param direct    Whether to do direct I/O on the file, bypassing the
+   *                  operating system's page cache.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the file cannot be opened, is
+   *                                  already open in another mode, or direct
+   *                                  I/O is asked for and the filesystem
+   *                                  does not do it or the file was not
+   *                                  created for it.
    */
-  static File open(const std::string &filename);
+  static File open(const std::string &filename, const bool direct = false);
+
+  /**
+   * Opens an existing file read-only and maps the whole of it into memory.
+   * Pages are read straight from the mapping, and any attempt to change the
+   * file throws a FileIOException.  A file that is already open must have
+   * been opened with openMapped() too.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the file cannot be opened or mapped,
+   *                                  or is already open in another mode.
+   */
+  static File openMapped(const std::string &filename);
 
   /**
    * Deletes an existing file.
@@ -140,14 +226,14 @@ class File {
    * @param rhs File object to compare.
    * @return True if the two files are equal.
    */
-  bool operator==(const File &rhs) const { return filename_ == rhs.filename_; }
+  bool operator==(const File &rhs) const { return id_ == rhs.id_; }
 
   /**
    * Check if two files are not equal.
    * @param rhs File object to compare.
    * @return True if the two files are not equal.
    */
-  bool operator!=(const File &rhs) const { return filename_ != rhs.filename_; }
+  bool operator!=(const File &rhs) const { return id_ != rhs.id_; }
 
   /**
    * Destructor that automatically closes the underlying file if no other
@@ -162,6 +248,15 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file without building it in memory.  A new
+   * page holds no records, so its header is all there is to it; the caller
+   * lays the page out from the header wherever the page is to live.
+   *
+   * @return Header of the new page.
+   */
+  PageHeader allocatePageHeader();
+
   /**
    * Reads an existing page from the file.
    *
@@ -172,6 +267,48 @@ class File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into the given page, with
+   * a single read and no intermediate copy.
+   *
+   * @param page_number   Number of page to read.
+   * @param dest          Page to read into.  Its contents are undefined if an
+   *                      exception is thrown.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  FileIOException       If the page cannot be read.
+   */
+  void readPage(const PageId page_number, Page &dest) const;
+
+  /**
+   * Returns an existing page of a file opened with openMapped() where it
+   * lies in the mapping, without copying it.  The page stays valid as long
+   * as any File object for the file is open.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page, which must not be changed.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  FileIOException       If the file is not mapped, or is shorter
+   *                                than its header says.
+   */
+  const Page *mappedPage(const PageId page_number) const;
+
+  /**
+   * Reads existing pages from the file straight into the given pages, like
+   * readPage(page_number, dest) for each of them, with all the reads in
+   * flight at once through an I/O engine.
+   *
+   * @param io            Engine to read through.
+   * @param page_numbers  Numbers of pages to read.
+   * @param dests         Pages to read into, one for each page number.
+   * @param errors        Set to what readPage() would have thrown for each
+   *                      page, or to null for the pages that were read.
+   */
+  void readPages(IoEngine &io, const std::vector<PageId> &page_numbers,
+                 const std::vector<Page *> &dests,
+                 std::vector<std::exception_ptr> &errors) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -181,6 +318,30 @@ class File {
    */
   void writePage(const Page &new_page);
 
+  /**
+   * Writes several pages into the file, like writePage() for each of them.
+   * The pages are written in page number order, each run of consecutive page
+   * numbers with a single write gathered straight from the pages.
+   *
+   * @param pages   Pages to write, in any order, with distinct page numbers.
+   * @throws  InvalidPageException  If one of the pages has been deleted, in
+   *                                which case none of them is written.
+   */
+  void writePages(const std::vector<const Page *> &pages);
+
+  /**
+   * Writes several pages into the file like writePages(), with the writes of
+   * all runs in flight at once through an I/O engine.
+   *
+   * @param io      Engine to write through.
+   * @param pages   Pages to write, in any order, with distinct page numbers.
+   * @throws  InvalidPageException  If one of the pages has been deleted, in
+   *                                which case none of them is written.
+   * @throws  FileIOException       If a write fails, after all of them have
+   *                                completed.
+   */
+  void writePages(IoEngine &io, const std::vector<const Page *> &pages);
+
   /**
    * Deletes a page from the file.
    *
@@ -195,6 +356,36 @@ class File {
    */
   const std::string &filename() const { return filename_; }
 
+  /**
+   * Returns the number identifying the file this object represents.  Every
+   * file name is given a number the first time it is opened, and keeps it
+   * for the lifetime of the process, so two File objects are equal exactly
+   * when their numbers are.  Invalid files have number 0.
+   *
+   * @return Number of file.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Returns true if the file does direct I/O, bypassing the operating
+   * system's page cache.
+   */
+  bool isDirect() const { return descriptor_ && descriptor_->mode == DIRECT; }
+
+  /**
+   * Returns true if the file is open read-only and mapped into memory.
+   */
+  bool isMapped() const { return descriptor_ && descriptor_->mode == MAPPED; }
+
+  /**
+   * Tells the operating system how the pages of the file are about to be
+   * accessed, so that it reads ahead accordingly: with madvise() on the
+   * mapping of a mapped file, and with posix_fadvise() otherwise.
+   *
+   * @param access  The expected access pattern.
+   */
+  void advise(const FileAccess access) const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -221,11 +412,16 @@ class File {
    * Creates an empty file
    * @return File object with valid_ bit set to false
    */
-  File() : valid_(false) {}
+  File() : id_(0), valid_(false) {}
 
  private:
   friend class BufMgr;
 
+  /**
+   * How the underlying file is opened.
+   */
+  enum Mode { BUFFERED, DIRECT, MAPPED };
+
   /**
    * Constructs a file object representing a file on the filesystem.
    * This method should not be called directly; instead use the static methods
@@ -235,39 +431,49 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param mode        How to open the file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  explicit File(const std::string &name, const bool create_new);
+  explicit File(const std::string &name, const bool create_new,
+                const Mode mode);
 
   /**
    * Returns the position of the page with the given number in the file (as an
-   * offset from the beginning of the file).
+   * offset from the beginning of the file).  In a file laid out for direct
+   * I/O the file header is page 0; otherwise page 1 follows the header.
    *
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  off_t pagePosition(const PageId page_number) const {
+    if (descriptor_->aligned) {
+      return off_t(page_number) * Page::SIZE;
+    }
+    return sizeof(FileHeader) + off_t(page_number - 1) * Page::SIZE;
   }
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor,
+   * which must have been opened in the same mode.
    *
    * @param create_new  Whether to create a new file.
+   * @param mode        How to open the file if it is opened.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileIOException         If the file is already open in another
+   *                                  mode, or cannot be opened or mapped.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const Mode mode);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Releases the underlying file descriptor in <descriptor_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -277,16 +483,34 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed beyond failing on a page past the end of
+   * the file.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
-   * @return  The page.
+   * @param dest          Page to read into.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  FileIOException       If the page cannot be read.
+   */
+  void readPage(const PageId page_number, const bool allow_free,
+                Page &dest) const;
+
+  /**
+   * Throws if the file may not be changed.
+   *
+   * @throws  FileIOException If the file is mapped read-only.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  void checkWritable() const;
+
+  /**
+   * Returns where the given bytes of a mapped file lie in the mapping.
+   *
+   * @param offset  Position of the first byte in the file.
+   * @param size    Number of bytes.
+   * @throws  FileIOException If the bytes lie past the end of the mapping.
+   */
+  const char *mappedAt(const off_t offset, const std::size_t size) const;
 
   /**
    * Writes a page into the file at the given page number.  This does not
@@ -311,14 +535,43 @@ class File {
                  const Page &new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Implements both writePages() overloads, writing synchronously if io is
+   * null.
+   *
+   * @param pages   Pages to write.
+   * @param io      Engine to write through, or null.
+   */
+  void writePages(const std::vector<const Page *> &pages, IoEngine *io);
+
+  /**
+   * Returns the header for this file, as it was last read from or written to
+   * disk.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Reads the header for this file, and the free list it starts, from disk
+   * into the descriptor.
+   */
+  void loadHeader();
+
+  /**
+   * Returns the header a page is to be written with: its own, except for the
+   * next page pointer on disk if allocating or deleting pages has changed
+   * that since the file was opened.  The caller holds the descriptor mutex.
+   *
+   * @param page  Page to write.
+   * @return  Header to write.
+   * @throws  InvalidPageException  If the page is not currently used.
+   */
+  PageHeader headerToWrite(const Page &page) const;
+
+  /**
+   * Writes the given header to the disk as the header for this file, and keeps
+   * it with the descriptor.  With direct I/O the rest of page 0 is filled
+   * with zeros.
    *
    * @param header  File header to write.
    */
@@ -333,28 +586,146 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream>> StreamMap;
+  /**
+   * @brief An open filesystem file, shared by every File object for it.
+   */
+  struct Descriptor {
+    /**
+     * Takes ownership of an open file.  A file opened for direct I/O gets
+     * its scratch page here.
+     *
+     * @param fd      Descriptor of the file.
+     * @param mode    How the file was opened.
+     * @param aligned Whether the file is laid out for direct I/O.
+     * @throws  std::bad_alloc  If the scratch page cannot be allocated, in
+     *                          which case the file is closed.
+     */
+    Descriptor(int fd, Mode mode, bool aligned);
+
+    /**
+     * Unmaps and closes the file, and frees the scratch page.
+     */
+    ~Descriptor();
+
+    /**
+     * Maps the whole file into memory read-only.
+     *
+     * @param filename  Name of the file, for errors.
+     * @throws  FileIOException If the file is too short to have a header or
+     *                          cannot be mapped.
+     */
+    void map(const std::string &filename);
+
+    Descriptor(const Descriptor &) = delete;
+    Descriptor &operator=(const Descriptor &) = delete;
+
+    /**
+     * Descriptor of the file.  Only used with positional I/O, so its offset
+     * is never relied on.
+     */
+    const int fd;
+
+    /**
+     * How the file was opened.
+     */
+    const Mode mode;
+
+    /**
+     * Whether the file header takes up the whole of page 0, so that every
+     * page lies at a multiple of Page::SIZE.  Always set for direct I/O.
+     */
+    const bool aligned;
+
+    /**
+     * One page of memory aligned for direct I/O, which headers and pages in
+     * unaligned memory pass through; null unless opened for direct I/O.
+     * Guarded by mutex.
+     */
+    char *scratch;
+
+    /**
+     * The file header, as on disk.  Guarded by mutex.
+     */
+    FileHeader header;
+
+    /**
+     * header.num_pages, for bounds checks that take no lock.
+     */
+    std::atomic<PageId> num_pages;
+
+    /**
+     * Pages on the free list, as many as header.num_free_pages.  Guarded by
+     * mutex.
+     */
+    std::unordered_set<PageId> free_pages;
+
+    /**
+     * Next page pointers that allocating and deleting pages have written
+     * since the file was opened, by page number.  Pages written later keep
+     * these instead of their own, which may predate them.  Entries are kept
+     * until the file is closed, so this grows with the number of pages
+     * allocated or deleted while it is open, up to one entry per page of
+     * the file.  Guarded by mutex.
+     */
+    std::unordered_map<PageId, PageId> next_pages;
+
+    /**
+     * Start of the mapping of a mapped file, or null.  The mapping covers
+     * the file as it was when it was opened.
+     */
+    const char *mapping;
+
+    /**
+     * Length of the mapping in bytes.
+     */
+    std::size_t mapping_size;
+
+    /**
+     * Serializes changes to the file header and the page lists.  Recursive
+     * because the public page operations are built out of the private
+     * header/page helpers.
+     */
+    std::recursive_mutex mutex;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Descriptor>> DescriptorMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, FileId> IdMap;
 
   /**
-   * Streams for opened files.
+   * Descriptors of opened files.
    */
-  static StreamMap open_streams_;
+  static DescriptorMap open_files_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Numbers given to the file names opened so far.
+   */
+  static IdMap file_ids_;
+
+  /**
+   * Guards open_files_, open_counts_ and file_ids_.
+   */
+  static std::mutex open_mutex_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Number of the file this object represents.
+   */
+  FileId id_;
+
+  /**
+   * Descriptor of underlying filesystem object.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<Descriptor> descriptor_;
 
   /**
    * Whether this file is valid.
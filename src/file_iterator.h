@@ -20,7 +20,9 @@ namespace badgerdb {
  * @brief Iterator for iterating over the pages in a file.
  *
  * This class provides a forward-only iterator for iterating over all of the
- * pages in a file.
+ * pages in a file.  On a file opened with File::openMapped(), it follows the
+ * pages through the mapping, so a scan that looks at them with mappedPage()
+ * makes no system calls and copies no pages.
  */
 class FileIterator {
  public:
@@ -80,12 +82,12 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
   inline bool operator==(const FileIterator &rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
+    return file_->id() == rhs.file_->id() &&
            current_page_number_ == rhs.current_page_number_;
   }
 
   inline bool operator!=(const FileIterator &rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
+    return (file_->id() != rhs.file_->id()) ||
            (current_page_number_ != rhs.current_page_number_);
   }
 
@@ -99,6 +101,16 @@ class FileIterator {
     return file_->readPage(current_page_number_);
   }
 
+  /**
+   * Returns the current page of a file opened with File::openMapped() where
+   * it lies in the mapping, without copying it.
+   *
+   * @return  Page in file.
+   */
+  inline const Page *mappedPage() const {
+    return file_->mappedPage(current_page_number_);
+  }
+
  private:
   /**
    * File we're iterating over.
@@ -0,0 +1,129 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "frame_arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Size of a transparent huge page on the platforms we run on.
+ */
+const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+std::size_t roundUp(std::size_t bytes, std::size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+FrameArena::FrameArena(std::uint32_t frames, bool huge_pages,
+                       std::uint32_t capacity)
+    : pages_(NULL),
+      versions_(NULL),
+      frames_(0),
+      versions_constructed_(0),
+      capacity_(std::max(frames, capacity)),
+      bytes_(0),
+      version_bytes_(0),
+      huge_pages_requested_(huge_pages),
+      huge_pages_(false) {
+  const std::size_t alignment =
+      huge_pages ? HUGE_PAGE_SIZE
+                 : static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  bytes_ = roundUp(std::max<std::size_t>(capacity_, 1) * Page::SIZE, alignment);
+
+  // mmap only guarantees system page alignment, so over-allocate by one huge
+  // page and trim both ends.
+  const std::size_t reserved = huge_pages ? bytes_ + alignment : bytes_;
+  void* mapping = mmap(NULL, reserved, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  char* start = static_cast<char*>(mapping);
+  if (huge_pages) {
+    char* aligned = reinterpret_cast<char*>(
+        roundUp(reinterpret_cast<std::uintptr_t>(start), alignment));
+    if (aligned > start) {
+      munmap(start, aligned - start);
+    }
+    if (start + reserved > aligned + bytes_) {
+      munmap(aligned + bytes_, start + reserved - (aligned + bytes_));
+    }
+    start = aligned;
+  }
+
+  pages_ = reinterpret_cast<Page*>(start);
+
+  version_bytes_ =
+      roundUp(std::max<std::size_t>(capacity_, 1) * sizeof(*versions_),
+              static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+  mapping = mmap(NULL, version_bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    munmap(pages_, bytes_);
+    throw std::bad_alloc();
+  }
+  versions_ = static_cast<std::atomic<std::uint64_t>*>(mapping);
+
+  resize(frames);
+}
+
+void FrameArena::resize(std::uint32_t frames) {
+#ifdef MADV_HUGEPAGE
+  if (huge_pages_requested_ && frames > frames_) {
+    // advise only the huge pages that frames are in, not the whole
+    // reservation
+    const std::size_t from = frames_ * Page::SIZE / HUGE_PAGE_SIZE *
+                             HUGE_PAGE_SIZE;
+    const std::size_t to = roundUp(frames * Page::SIZE, HUGE_PAGE_SIZE);
+    if (madvise(reinterpret_cast<char*>(pages_) + from, to - from,
+                MADV_HUGEPAGE) == 0) {
+      huge_pages_ = true;
+    }
+  }
+#endif
+  for (std::uint32_t i = frames_; i < frames; i++) {
+    new (&pages_[i]) Page();
+  }
+  for (; versions_constructed_ < frames; versions_constructed_++) {
+    new (&versions_[versions_constructed_]) std::atomic<std::uint64_t>(0);
+  }
+  for (std::uint32_t i = frames; i < frames_; i++) {
+    pages_[i].~Page();
+  }
+  if (frames < frames_) {
+    // release the whole system pages past the last frame
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t from = roundUp(frames * Page::SIZE, page_size);
+    const std::size_t to = roundUp(frames_ * Page::SIZE, page_size);
+    if (to > from) {
+      madvise(reinterpret_cast<char*>(pages_) + from, to - from,
+              MADV_DONTNEED);
+    }
+  }
+  frames_ = frames;
+}
+
+FrameArena::~FrameArena() {
+  for (std::uint32_t i = 0; i < frames_; i++) {
+    pages_[i].~Page();
+  }
+  munmap(pages_, bytes_);
+  munmap(versions_, version_bytes_);
+}
+
+}  // namespace badgerdb
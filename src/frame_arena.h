@@ -0,0 +1,171 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Page frames of the buffer pool in one contiguous mapping.
+ *
+ * Frame i is the Page at byte offset i * Page::SIZE from the start of the
+ * arena, which is aligned to the system page size, or to the huge page size
+ * when huge pages are requested, so frames can be read and written with
+ * direct I/O as they are.  The mapping is made with mmap() so that the memory
+ * of the pool is accounted for as a single region.
+ *
+ * Address space is reserved up front for a maximum number of frames so that
+ * the arena can be resized without moving the frames in use.  Memory is only
+ * committed as frames are touched, and is returned to the system when the
+ * arena shrinks.
+ *
+ * Every frame also has a version counter for optimistic readers.  Versions
+ * are kept when the arena shrinks, so a frame that is removed and added back
+ * never repeats a version.
+ */
+class FrameArena {
+ public:
+  /**
+   * Maps an arena and constructs an empty page in every frame.
+   *
+   * @param frames      Number of frames
+   * @param huge_pages  If true, align the arena to huge pages and ask the
+   *                    kernel to back the frames in use with transparent
+   *                    huge pages
+   * @param capacity    Maximum number of frames the arena can be resized to;
+   *                    raised to frames if smaller
+   * @throws std::bad_alloc If the mapping cannot be made
+   */
+  FrameArena(std::uint32_t frames, bool huge_pages = false,
+             std::uint32_t capacity = 0);
+
+  /**
+   * Unmaps the arena.
+   */
+  ~FrameArena();
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  /**
+   * Returns the page in a frame.
+   *
+   * @param frame   Frame number
+   */
+  Page& operator[](FrameId frame) { return pages_[frame]; }
+
+  /**
+   * Returns the page in a frame.
+   *
+   * @param frame   Frame number
+   */
+  const Page& operator[](FrameId frame) const { return pages_[frame]; }
+
+  /**
+   * Returns the frame holding a page of the arena.
+   *
+   * @param page    Page in the arena
+   */
+  FrameId frameOf(const Page* page) const { return page - pages_; }
+
+  /**
+   * Returns the version counter of a frame.
+   *
+   * @param frame   Frame number, below capacity()
+   */
+  std::atomic<std::uint64_t>& version(FrameId frame) {
+    return versions_[frame];
+  }
+
+  /**
+   * Change the number of frames.  Frames that are added hold an empty page;
+   * the memory of frames that are removed is released.  Frames below the
+   * smaller of the two sizes are untouched.
+   *
+   * @param frames  New number of frames, at most capacity()
+   */
+  void resize(std::uint32_t frames);
+
+  /**
+   * Returns the number of frames in the arena.
+   */
+  std::uint32_t size() const { return frames_; }
+
+  /**
+   * Returns the maximum number of frames.
+   */
+  std::uint32_t capacity() const { return capacity_; }
+
+  /**
+   * Returns the number of bytes of address space mapped for the arena.
+   */
+  std::size_t bytes() const { return bytes_; }
+
+  /**
+   * Returns true if the kernel accepted the request for huge pages.
+   */
+  bool hugePages() const { return huge_pages_; }
+
+ private:
+  /**
+   * First frame of the arena.
+   */
+  Page* pages_;
+
+  /**
+   * Version counters of the frames, mapped for capacity_ frames.
+   */
+  std::atomic<std::uint64_t>* versions_;
+
+  /**
+   * Number of frames.
+   */
+  std::uint32_t frames_;
+
+  /**
+   * Number of version counters constructed; the largest size so far.
+   */
+  std::uint32_t versions_constructed_;
+
+  /**
+   * Maximum number of frames.
+   */
+  std::uint32_t capacity_;
+
+  /**
+   * Number of bytes mapped for capacity_ frames, a multiple of the
+   * alignment.
+   */
+  std::size_t bytes_;
+
+  /**
+   * Number of bytes mapped for versions_.
+   */
+  std::size_t version_bytes_;
+
+  /**
+   * True if the arena was asked to use transparent huge pages.  The advice
+   * is given for the frames in use as they are added, not for the whole
+   * reservation.
+   */
+  bool huge_pages_requested_;
+
+  /**
+   * True if the arena is advised to use transparent huge pages.
+   */
+  bool huge_pages_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,517 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BADGERDB_IO_URING 1
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Carries out a request with one blocking system call.
+ */
+ssize_t perform(const IoRequest &request) {
+  while (true) {
+    const ssize_t n =
+        request.write
+            ? ::pwritev(request.fd, request.iov, request.iovcnt, request.offset)
+            : ::preadv(request.fd, request.iov, request.iovcnt, request.offset);
+    if (n >= 0) {
+      return n;
+    }
+    if (errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+/**
+ * @brief Engine emulating asynchronous I/O on a pool of threads.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * Most threads a pool starts; more would mostly add contention
+   */
+  static const unsigned MAX_THREADS = 16;
+
+  explicit ThreadPoolIoEngine(unsigned depth) : stop(false) {
+    for (unsigned t = 0; t < std::min(depth, MAX_THREADS); t++) {
+      threads.emplace_back(&ThreadPoolIoEngine::run, this);
+    }
+  }
+
+  ~ThreadPoolIoEngine() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    queued.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void submit(const std::vector<IoRequest *> &requests) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.insert(queue.end(), requests.begin(), requests.end());
+    }
+    queued.notify_all();
+  }
+
+  bool usesUring() const override { return false; }
+
+ private:
+  /**
+   * Main loop of a pool thread
+   */
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      queued.wait(lock, [this] { return stop || !queue.empty(); });
+      if (stop) {
+        return;
+      }
+      IoRequest *request = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      complete(*request, perform(*request));
+      lock.lock();
+    }
+  }
+
+  /**
+   * Requests no thread has taken yet, oldest first
+   */
+  std::deque<IoRequest *> queue;
+
+  /**
+   * Guards queue and stop
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when requests are queued or the threads should stop
+   */
+  std::condition_variable queued;
+
+  /**
+   * Set when the threads should exit
+   */
+  bool stop;
+
+  std::vector<std::thread> threads;
+};
+
+const unsigned ThreadPoolIoEngine::MAX_THREADS;
+
+#ifdef BADGERDB_IO_URING
+
+/**
+ * @brief Engine on an io_uring instance.
+ *
+ * Threads fill submission queue entries under submitMutex and hand them to
+ * the kernel right away.  A reaper thread waits for completions and passes
+ * them on to the waiters.  The number of requests in flight is kept within
+ * the depth, which the completion queue is larger than, so that completions
+ * are never dropped.
+ *
+ * Entries are never taken back once the tail is published.  If the kernel
+ * refuses them, their requests fail and the entries are turned into no-ops
+ * that the next submission hands over.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Times submission is retried after the kernel is short of resources
+   * while nothing is in flight, sleeping twice as long every time
+   */
+  static const int MAX_RETRIES = 8;
+
+  /**
+   * Returns an engine, or NULL if the kernel does not offer io_uring.
+   */
+  static UringIoEngine *tryCreate(unsigned depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd = syscall(__NR_io_uring_setup, depth, &params);
+    if (fd < 0) {
+      return NULL;
+    }
+    UringIoEngine *engine = new UringIoEngine(fd, params, depth);
+    if (!engine->mapRings()) {
+      delete engine;
+      return NULL;
+    }
+    engine->reaper = std::thread(&UringIoEngine::reap, engine);
+    return engine;
+  }
+
+  ~UringIoEngine() override {
+    if (reaper.joinable()) {
+      // a no-op without a request tells the reaper to exit
+      std::unique_lock<std::mutex> lock(submitMutex);
+      push(IORING_OP_NOP, NULL, lock);
+      enter(lock);
+      lock.unlock();
+      reaper.join();
+    }
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+      munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != MAP_FAILED) {
+      munmap(sqRing, sqRingSize);
+    }
+    close(ringFd);
+  }
+
+  void submit(const std::vector<IoRequest *> &requests) override {
+    std::unique_lock<std::mutex> lock(submitMutex);
+    for (IoRequest *request : requests) {
+      push(request->write ? IORING_OP_WRITEV : IORING_OP_READV, request,
+           lock);
+    }
+    enter(lock);
+  }
+
+  bool usesUring() const override { return true; }
+
+ private:
+  UringIoEngine(int fd, const io_uring_params &params, unsigned depth)
+      : ringFd(fd),
+        params(params),
+        depth(depth),
+        sqRing(MAP_FAILED),
+        cqRing(MAP_FAILED),
+        sqes(static_cast<io_uring_sqe *>(MAP_FAILED)),
+        inFlight(0),
+        pending(0),
+        reaped(0) {}
+
+  /**
+   * Maps the queues shared with the kernel.
+   */
+  bool mapRings() {
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+      sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+    sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+      return false;
+    }
+    cqRing = single ? sqRing
+                    : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ringFd,
+                           IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED) {
+      return false;
+    }
+    sqes = static_cast<io_uring_sqe *>(
+        mmap(NULL, params.sq_entries * sizeof(io_uring_sqe),
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+             IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cqRing);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  /**
+   * Queues an entry for a request, or a no-op for NULL, waiting for room in
+   * flight.  The caller holds submitMutex through lock.
+   */
+  void push(const std::uint8_t opcode, IoRequest *request,
+            std::unique_lock<std::mutex> &lock) {
+    if (inFlight + pending >= depth) {
+      // hand over what is queued, so that it can complete and make room
+      enter(lock);
+      room.wait(lock, [this] { return inFlight < depth; });
+    }
+    if (*sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) ==
+            params.sq_entries &&
+        !enter(lock)) {
+      // the queue is full of entries the kernel refuses
+      if (request) {
+        complete(*request, -EAGAIN);
+      }
+      return;
+    }
+    const unsigned tail = *sqTail;
+    const unsigned index = tail & sqMask;
+    io_uring_sqe &sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = -1;
+    if (request) {
+      sqe.fd = request->fd;
+      sqe.off = request->offset;
+      sqe.addr = reinterpret_cast<std::uint64_t>(request->iov);
+      sqe.len = request->iovcnt;
+    }
+    sqe.user_data = reinterpret_cast<std::uint64_t>(request);
+    sqArray[index] = index;
+    // the entry must be complete before the kernel sees the new tail
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    pending++;
+  }
+
+  /**
+   * Hands the queued entries to the kernel.  The caller holds submitMutex
+   * through lock, which is released while waiting for the kernel to have
+   * room.
+   *
+   * @return  False if the kernel refused the entries, whose requests have
+   *          then failed
+   */
+  bool enter(std::unique_lock<std::mutex> &lock) {
+    int retries = 0;
+    while (pending > 0) {
+      const int n = syscall(__NR_io_uring_enter, ringFd, pending, 0, 0, NULL,
+                            0);
+      if (n >= 0) {
+        inFlight += n;
+        pending -= n;
+        continue;
+      }
+      const int error = errno;
+      if (error == EINTR) {
+        continue;
+      }
+      if (error == EAGAIN || error == EBUSY) {
+        if (inFlight > 0) {
+          // completions free what the kernel is short of
+          const std::uint64_t seen = reaped;
+          room.wait(lock, [this, seen] { return reaped != seen; });
+          continue;
+        }
+        if (retries < MAX_RETRIES) {
+          lock.unlock();
+          std::this_thread::sleep_for(
+              std::chrono::microseconds(100 << retries));
+          lock.lock();
+          retries++;
+          continue;
+        }
+      }
+      fail(error);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Fails the requests of the entries the kernel has not taken, and turns
+   * the entries into no-ops.  The kernel only reads entries during
+   * io_uring_enter(), which the caller keeps others from calling by holding
+   * submitMutex, so entries past the head can still be changed.
+   *
+   * @param error   errno value to fail the requests with
+   */
+  void fail(const int error) {
+    const unsigned tail = *sqTail;
+    for (unsigned i = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE); i != tail;
+         i++) {
+      io_uring_sqe &sqe = sqes[sqArray[i & sqMask]];
+      IoRequest *request = reinterpret_cast<IoRequest *>(sqe.user_data);
+      if (!request) {
+        // the no-op that stops the reaper
+        continue;
+      }
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_NOP;
+      sqe.fd = -1;
+      sqe.user_data = FAILED;
+      complete(*request, -error);
+    }
+  }
+
+  /**
+   * Main loop of the reaper thread
+   */
+  void reap() {
+    std::vector<std::pair<IoRequest *, ssize_t>> done;
+    bool stop = false;
+    while (!stop) {
+      unsigned head = *cqHead;
+      const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+      if (head == tail) {
+        syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+                NULL, 0);
+        continue;
+      }
+      done.clear();
+      const unsigned count = tail - head;
+      for (; head != tail; head++) {
+        const io_uring_cqe &cqe = cqes[head & cqMask];
+        if (cqe.user_data == FAILED) {
+          continue;
+        }
+        IoRequest *request = reinterpret_cast<IoRequest *>(cqe.user_data);
+        if (request) {
+          done.emplace_back(request, cqe.res);
+        } else {
+          stop = true;
+        }
+      }
+      // the entries must be read before the kernel may reuse them
+      __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+      {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        inFlight -= count;
+        reaped += count;
+      }
+      room.notify_all();
+      for (const auto &d : done) {
+        complete(*d.first, d.second);
+      }
+    }
+  }
+
+  /**
+   * user_data of the no-ops that replace entries of failed requests; no
+   * request lies at this address
+   */
+  static const std::uint64_t FAILED = 1;
+
+  const int ringFd;
+  io_uring_params params;
+
+  /**
+   * Most requests in flight, no more than the submission queue holds
+   */
+  const unsigned depth;
+
+  void *sqRing;
+  std::size_t sqRingSize;
+  void *cqRing;
+  std::size_t cqRingSize;
+  io_uring_sqe *sqes;
+
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned cqMask;
+  io_uring_cqe *cqes;
+
+  /**
+   * Guards the submission queue, inFlight, pending and reaped
+   */
+  std::mutex submitMutex;
+
+  /**
+   * Signalled when entries complete
+   */
+  std::condition_variable room;
+
+  /**
+   * Number of entries the kernel has taken and not completed yet
+   */
+  unsigned inFlight;
+
+  /**
+   * Number of entries queued but not handed to the kernel yet
+   */
+  unsigned pending;
+
+  /**
+   * Number of entries completed so far
+   */
+  std::uint64_t reaped;
+
+  /**
+   * Thread collecting completions
+   */
+  std::thread reaper;
+};
+
+const int UringIoEngine::MAX_RETRIES;
+const std::uint64_t UringIoEngine::FAILED;
+
+#endif  // BADGERDB_IO_URING
+
+}  // namespace
+
+const unsigned IoEngine::DEFAULT_DEPTH;
+
+std::unique_ptr<IoEngine> IoEngine::create(unsigned depth, bool useUring) {
+  depth = std::max(depth, 1u);
+#ifdef BADGERDB_IO_URING
+  if (useUring) {
+    // the kernel limits the size of a ring
+    if (IoEngine *engine = UringIoEngine::tryCreate(std::min(depth, 4096u))) {
+      return std::unique_ptr<IoEngine>(engine);
+    }
+  }
+#endif
+  return std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(depth));
+}
+
+void IoEngine::wait(IoRequest &request) {
+  std::unique_lock<std::mutex> lock(doneMutex);
+  if (request.done) {
+    return;
+  }
+  std::condition_variable completed;
+  request.waiter = &completed;
+  completed.wait(lock, [&request] { return request.done; });
+  request.waiter = NULL;
+}
+
+void IoEngine::complete(IoRequest &request, ssize_t result) {
+  std::lock_guard<std::mutex> lock(doneMutex);
+  request.result = result;
+  request.done = true;
+  if (request.waiter) {
+    // under the lock, as the waiter's condition variable is gone once it
+    // sees the request done
+    request.waiter->notify_one();
+  }
+}
+
+}  // namespace badgerdb
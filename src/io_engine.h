@@ -0,0 +1,159 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief A positional read or write submitted to an IoEngine.
+ *
+ * The submitter fills in the fields up to iovcnt and keeps the request and
+ * its buffers alive until IoEngine::wait() returns for it.
+ */
+struct IoRequest {
+  IoRequest()
+      : write(false),
+        fd(-1),
+        offset(0),
+        iov(NULL),
+        iovcnt(0),
+        result(0),
+        done(false),
+        waiter(NULL) {}
+
+  /**
+   * True to write the buffers, false to read into them
+   */
+  bool write;
+
+  /**
+   * Descriptor of the file
+   */
+  int fd;
+
+  /**
+   * Position in the file of the first byte
+   */
+  off_t offset;
+
+  /**
+   * Buffers, filled or written one after the other
+   */
+  iovec *iov;
+
+  /**
+   * Number of buffers, at most IOV_MAX
+   */
+  int iovcnt;
+
+  /**
+   * Once done, the number of bytes transferred, which may be short, or a
+   * negated errno value
+   */
+  ssize_t result;
+
+  /**
+   * Set when the request has completed.  Guarded by the engine.
+   */
+  bool done;
+
+  /**
+   * Signalled when the request completes, set while a thread waits for it.
+   * Guarded by the engine.
+   */
+  std::condition_variable *waiter;
+};
+
+/**
+ * @brief Asynchronous file I/O that keeps many requests in flight at once.
+ *
+ * Requests are started with submit() and collected with wait(), from any
+ * number of threads.  create() returns an engine on io_uring, set up through
+ * the raw system calls, or an emulation on a pool of threads doing blocking
+ * positional I/O where the kernel does not offer io_uring.
+ *
+ * A request is carried out once, like a single preadv() or pwritev(); a
+ * short transfer is left to the submitter to finish.
+ */
+class IoEngine {
+ public:
+  /**
+   * Number of requests an engine lets be in flight by default
+   */
+  static const unsigned DEFAULT_DEPTH = 256;
+
+  /**
+   * Creates an engine.
+   *
+   * @param depth     Number of requests kept in flight at once; more wait
+   *                  until others complete
+   * @param useUring  Whether to try io_uring before falling back to threads
+   * @return  The engine
+   */
+  static std::unique_ptr<IoEngine> create(unsigned depth = DEFAULT_DEPTH,
+                                          bool useUring = true);
+
+  /**
+   * Stops the engine.  No request may be in flight.
+   */
+  virtual ~IoEngine() {}
+
+  IoEngine(const IoEngine &) = delete;
+  IoEngine &operator=(const IoEngine &) = delete;
+
+  /**
+   * Start requests.  Returns once all of them are submitted, usually before
+   * they complete.
+   *
+   * @param requests  Requests to start, not done
+   */
+  virtual void submit(const std::vector<IoRequest *> &requests) = 0;
+
+  /**
+   * Wait until a submitted request has completed.  At most one thread may
+   * wait for a request.
+   *
+   * @param request   Request to wait for
+   */
+  void wait(IoRequest &request);
+
+  /**
+   * Returns true if the engine runs on io_uring rather than on threads.
+   */
+  virtual bool usesUring() const = 0;
+
+ protected:
+  IoEngine() {}
+
+  /**
+   * Record the result of a request and wake up its waiter.
+   *
+   * @param request   Request that completed
+   * @param result    Bytes transferred, or a negated errno value
+   */
+  void complete(IoRequest &request, ssize_t result);
+
+ private:
+  /**
+   * Guards the done flags and waiters of requests.  Each waiter has a
+   * condition variable of its own, so a completion wakes only the thread
+   * waiting for that request.
+   */
+  std::mutex doneMutex;
+};
+
+}  // namespace badgerdb
@@ -2,17 +2,30 @@
 
 #include <iostream>
 //#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <map>
 #include <memory>
 #include <optional>
+#include <thread>
+#include <vector>
 
+#include "buf_trace.h"
 #include "buffer.h"
+#include "concurrent_page_table.h"
+#include "epoch.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "file_iterator.h"
+#include "io_engine.h"
 #include "page.h"
 #include "page_iterator.h"
 
@@ -40,6 +53,32 @@ void test3(File &file4);
 void test4(File &file4);
 void test5(File &file4);
 void test6(File &file1);
+void test7(File &file1);
+void test8(File &file1);
+void test9(File &file1);
+void test10(File &file1);
+void test11(File &file1);
+void test12(File &file1);
+void test13(File &file1);
+void test14(File &file1);
+void test15(File &file1, File &file2);
+void test16(File &file1);
+void test17(File &file1, File &file2);
+void test18(File &file1);
+void test19(File &file1);
+void test20(File &file1);
+void test21(File &file1);
+void test22(File &file1);
+void test23(File &file1, File &file2);
+void test24(File &file1, File &file2);
+void test25(File &file1, File &file2);
+void test26(File &file1);
+void test27(File &file3);
+void test28(File &file3);
+void test29();
+void test30();
+void test31();
+void test32();
 // Calls the above tests
 void testBufMgr();
 
@@ -144,6 +183,32 @@ void testBufMgr() {
     test4(file4);
     test5(file5);
     test6(file1);
+    test7(file1);
+    test8(file1);
+    test9(file1);
+    test10(file1);
+    test11(file1);
+    test12(file1);
+    test13(file1);
+    test14(file1);
+    test15(file1, file2);
+    test16(file1);
+    test17(file1, file2);
+    test18(file1);
+    test19(file1);
+    test20(file1);
+    test21(file1);
+    test22(file1);
+    test23(file1, file2);
+    test24(file1, file2);
+    test25(file1, file2);
+    test26(file1);
+    test27(file3);
+    test28(file3);
+    test29();
+    test30();
+    test31();
+    test32();
 
     // Close the files by going out of scope
   }
@@ -300,3 +365,1431 @@ void test6(File &file1) {
 
   bufMgr->flushFile(file1);
 }
+
+void test7(File &file1) {
+  // Concurrent readers on a sharded buffer pool
+  const int numThreads = 4;
+  BufMgr sharded(num / 2, numThreads);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&sharded, &file1, &failed, t]() {
+      for (int round = 0; round < 10; round++) {
+        for (PageId j = 1; j <= num; j++) {
+          PageId pageNo = (j + t * num / numThreads) % num + 1;
+          Page *p;
+          sharded.readPage(file1, pageNo, p);
+          if (p->page_number() != pageNo) failed = true;
+          sharded.unPinPage(file1, pageNo, false);
+        }
+      }
+    });
+  }
+  for (std::thread &th : threads) th.join();
+  if (failed) {
+    PRINT_ERROR("ERROR :: CONCURRENT READ RETURNED THE WRONG PAGE");
+  }
+  sharded.flushFile(file1);
+
+  std::cout << "Test 7 passed"
+            << "\n";
+}
+
+void test8(File &file1) {
+  // Every replacement policy keeps a hot set and a scan correct, and refuses
+  // to allocate once all frames are pinned
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+  const std::uint32_t frames = 10;
+  for (ReplacementPolicyType policy : policies) {
+    BufMgr mgr(frames, 1, policy);
+    for (PageId j = 1; j <= num; j++) {
+      PageId pageNo = (j % 3 == 0) ? j % 5 + 1 : j;
+      mgr.readPage(file1, pageNo, page);
+      if (page->page_number() != pageNo) {
+        PRINT_ERROR("ERROR :: POLICY RETURNED THE WRONG PAGE");
+      }
+      mgr.unPinPage(file1, pageNo, false);
+    }
+
+    for (PageId j = 1; j <= frames; j++) mgr.readPage(file1, j, page);
+    try {
+      mgr.readPage(file1, frames + 1, page);
+      PRINT_ERROR(
+          "ERROR :: No more frames left for allocation. Exception should "
+          "have been thrown before execution reaches this point.");
+    } catch (const BufferExceededException &e) {
+    }
+    for (PageId j = 1; j <= frames; j++) mgr.unPinPage(file1, j, false);
+    mgr.flushFile(file1);
+  }
+
+  std::cout << "Test 8 passed"
+            << "\n";
+}
+
+void test9(File &file1) {
+  // The background writer cleans dirty unpinned pages without a flushFile
+  BufWriterConfig writer;
+  writer.enabled = true;
+  writer.intervalMs = 1;
+  writer.dirtyRatioTarget = 0;
+  const PageId pages = 10;
+  BufMgr mgr(num, 1, ReplacementPolicyType::CLOCK, writer);
+  RecordId written[pages];
+  for (PageId j = 0; j < pages; j++) {
+    mgr.readPage(file1, j + 1, page);
+    written[j] = page->insertRecord("written in the background");
+    mgr.unPinPage(file1, j + 1, true);
+  }
+
+  for (PageId j = 0; j < pages; j++) {
+    bool onDisk = false;
+    for (int attempt = 0; attempt < 1000 && !onDisk; attempt++) {
+      try {
+        Page p = file1.readPage(j + 1);
+        onDisk = p.getRecord(written[j]) == "written in the background";
+      } catch (const InvalidRecordException &e) {
+      }
+      if (!onDisk) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!onDisk) {
+      PRINT_ERROR("ERROR :: BACKGROUND WRITER DID NOT WRITE THE PAGE");
+    }
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 9 passed"
+            << "\n";
+}
+
+void test10(File &file1) {
+  // Prefetched pages can be read while, or after, they are loaded, and
+  // prefetching pages that do not exist is harmless
+  BufMgr mgr(num);
+  mgr.prefetchRange(file1, 1, num / 2);
+  mgr.prefetch(file1, {num + 1, num + 2});
+  for (PageId j = 1; j <= num / 2; j++) {
+    mgr.readPage(file1, j, page);
+    if (page->page_number() != j) {
+      PRINT_ERROR("ERROR :: PREFETCHED PAGE HAS THE WRONG CONTENTS");
+    }
+    mgr.unPinPage(file1, j, false);
+  }
+  try {
+    mgr.readPage(file1, num + 1, page);
+    PRINT_ERROR(
+        "ERROR :: Page does not exist. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 10 passed"
+            << "\n";
+}
+
+void test11(File &file1) {
+  // Scans through a ring, explicit or detected, return the right pages and
+  // leave the unpinned hot set in the pool
+  BufMgr mgr(num / 4);
+  for (PageId j = 1; j <= num / 8; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.unPinPage(file1, j, false);
+  }
+  BufAccessStrategy strategy(mgr);
+  for (int detect = 0; detect < 2; detect++) {
+    if (detect) {
+      mgr.setScanDetection(4, 8);
+    }
+    for (PageId j = num / 8 + 1; j <= num; j++) {
+      mgr.readPage(file1, j, page, detect ? NULL : &strategy);
+      if (page->page_number() != j) {
+        PRINT_ERROR("ERROR :: SCANNED PAGE HAS THE WRONG CONTENTS");
+      }
+      mgr.unPinPage(file1, j, false);
+    }
+
+    // the hot pages are all hits, with nothing read from disk
+    const BufStats before = mgr.getBufStats();
+    for (PageId j = 1; j <= num / 8; j++) {
+      mgr.readPage(file1, j, page);
+      mgr.unPinPage(file1, j, false);
+    }
+    const BufStats after = mgr.getBufStats();
+    if (after.hits - before.hits != num / 8 ||
+        after.diskreads != before.diskreads) {
+      PRINT_ERROR("ERROR :: SCAN EVICTED THE HOT SET");
+    }
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 11 passed"
+            << "\n";
+}
+
+void test12(File &file1) {
+  // Batched reads pin every page once per occurrence, and a batch that fails
+  // leaves nothing pinned
+  BufMgr mgr(num / 4, 4);
+  std::vector<PageId> batch;
+  std::vector<Page *> pages;
+  for (PageId j = num / 10; j > 0; j--) {
+    batch.push_back(j);
+    batch.push_back(j * 2);
+  }
+  mgr.readPages(file1, batch, pages);
+  for (std::size_t j = 0; j < batch.size(); j++) {
+    if (pages[j]->page_number() != batch[j]) {
+      PRINT_ERROR("ERROR :: BATCHED PAGE HAS THE WRONG CONTENTS");
+    }
+  }
+  mgr.unPinPages(file1, batch, true);
+  try {
+    mgr.unPinPages(file1, {1, 2}, false);
+    PRINT_ERROR(
+        "ERROR :: Pages are not pinned. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const PageNotPinnedException &e) {
+  }
+
+  batch.clear();
+  for (PageId j = 1; j <= num / 4 + 1; j++) {
+    batch.push_back(j);
+  }
+  try {
+    mgr.readPages(file1, batch, pages);
+    PRINT_ERROR(
+        "ERROR :: No more frames left for allocation. Exception should have "
+        "been thrown before execution reaches this point.");
+  } catch (const BufferExceededException &e) {
+  }
+  try {
+    mgr.readPages(file1, {1, 2, num + 1}, pages);
+    PRINT_ERROR(
+        "ERROR :: Page does not exist. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 12 passed"
+            << "\n";
+}
+
+void test13(File &file1) {
+  // Frames are consecutive page-aligned blocks, with or without huge pages,
+  // and pages survive a round trip through them
+  for (int huge = 0; huge < 2; huge++) {
+    BufMgr mgr(num / 4, 2, ReplacementPolicyType::CLOCK, BufWriterConfig(),
+               huge == 1);
+    const char *base = reinterpret_cast<const char *>(&mgr.bufPool[0]);
+    if (reinterpret_cast<std::uintptr_t>(base) % 4096 != 0 ||
+        reinterpret_cast<const char *>(&mgr.bufPool[num / 4 - 1]) !=
+            base + (num / 4 - 1) * Page::SIZE) {
+      PRINT_ERROR("ERROR :: FRAMES ARE NOT CONTIGUOUS AND ALIGNED");
+    }
+
+    mgr.readPage(file1, 1, page);
+    rid[1] = page->insertRecord("arena");
+    mgr.unPinPage(file1, 1, true);
+    mgr.flushFile(file1);
+    mgr.readPage(file1, 1, page);
+    if (page->getRecord(rid[1]) != "arena") {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    page->deleteRecord(rid[1]);
+    mgr.unPinPage(file1, 1, true);
+    mgr.flushFile(file1);
+  }
+
+  std::cout << "Test 13 passed"
+            << "\n";
+}
+
+void test14(File &file1) {
+  // Growing and shrinking the pool keeps its pages, including dirty ones, and
+  // concurrent readers keep working while it happens
+  BufMgr mgr(num / 4, 2);
+  BufMgr bounded(num / 4, 2, ReplacementPolicyType::CLOCK, BufWriterConfig(),
+                 false, num);
+  if (mgr.getMaxBufs() != num / 4 * BufMgr::GROWTH_FACTOR ||
+      bounded.getMaxBufs() != num ||
+      bounded.bufPool.bytes() != num * Page::SIZE) {
+    PRINT_ERROR("ERROR :: POOL RESERVED THE WRONG NUMBER OF FRAMES");
+  }
+  mgr.readPage(file1, 1, page);
+  rid[1] = page->insertRecord("resized");
+  mgr.unPinPage(file1, 1, true);
+
+  mgr.resize(num / 2);
+  for (PageId j = 1; j <= num / 4; j++) {
+    mgr.readPage(file1, j, page);
+  }
+  try {
+    mgr.resize(num / 8);
+    PRINT_ERROR(
+        "ERROR :: Pages pinned in removed frames. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const PagePinnedException &e) {
+  }
+  for (PageId j = 1; j <= num / 4; j++) {
+    mgr.unPinPage(file1, j, false);
+  }
+  mgr.resize(num / 8);
+  if (mgr.getNumBufs() != num / 8) {
+    PRINT_ERROR("ERROR :: POOL HAS THE WRONG SIZE");
+  }
+  mgr.readPage(file1, 1, page);
+  if (page->getRecord(rid[1]) != "resized") {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  page->deleteRecord(rid[1]);
+  mgr.unPinPage(file1, 1, true);
+  try {
+    mgr.resize(mgr.getMaxBufs() + 1);
+    PRINT_ERROR(
+        "ERROR :: Pool cannot grow past its reservation. Exception should "
+        "have been thrown before execution reaches this point.");
+  } catch (const BufferExceededException &e) {
+  }
+
+  const int numThreads = 4;
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  std::atomic<bool> done(false);
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&mgr, &file1, &failed, &done, t]() {
+      while (!done) {
+        for (PageId j = 1; j <= num; j++) {
+          PageId pageNo = (j + t * num / numThreads) % num + 1;
+          Page *p;
+          mgr.readPage(file1, pageNo, p);
+          if (p->page_number() != pageNo) failed = true;
+          mgr.unPinPage(file1, pageNo, false);
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 20; round++) {
+    try {
+      mgr.resize(round % 2 == 0 ? num : num / 8);
+    } catch (const PagePinnedException &e) {
+    }
+  }
+  done = true;
+  for (std::thread &th : threads) th.join();
+  if (failed) {
+    PRINT_ERROR("ERROR :: CONCURRENT READ RETURNED THE WRONG PAGE");
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 14 passed"
+            << "\n";
+}
+
+void test15(File &file1, File &file2) {
+  // Flushing a file writes and drops only that file's pages
+  BufMgr mgr(num / 2, 2);
+  for (PageId j = 1; j <= num / 10; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.readPage(file2, j, page2);
+    if (j == 1) {
+      rid[1] = page->insertRecord("flushed");
+    }
+    mgr.unPinPage(file1, j, j == 1);
+    if (j != 2) {
+      mgr.unPinPage(file2, j, false);
+    }
+  }
+  mgr.flushFile(file1);
+  try {
+    mgr.flushFile(file2);
+    PRINT_ERROR(
+        "ERROR :: Page is pinned. Exception should have been thrown before "
+        "execution reaches this point.");
+  } catch (const PagePinnedException &e) {
+  }
+  mgr.unPinPage(file2, 2, false);
+  mgr.flushFile(file2);
+
+  BufMgr other(num / 10);
+  other.readPage(file1, 1, page);
+  if (page->getRecord(rid[1]) != "flushed") {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  page->deleteRecord(rid[1]);
+  other.unPinPage(file1, 1, true);
+  other.flushFile(file1);
+
+  std::cout << "Test 15 passed"
+            << "\n";
+}
+
+void test16(File &file1) {
+  // A checkpoint writes dirty pages dirtied in random order, keeps them in
+  // the pool, and leaves the file's page list intact
+  BufMgr mgr(num, 4);
+  std::vector<PageId> order;
+  for (PageId j = 1; j <= num; j++) {
+    order.push_back(j);
+  }
+  for (PageId j = num; j > 1; j--) {
+    std::swap(order[j - 1], order[random() % j]);
+  }
+  for (PageId j : order) {
+    mgr.readPage(file1, j, page);
+    rid[j - 1] = page->insertRecord("checkpoint");
+    mgr.unPinPage(file1, j, true);
+  }
+  mgr.checkpointFile(file1);
+
+  {
+    BufMgr other(num / 10);
+    for (PageId j = 1; j <= num; j++) {
+      other.readPage(file1, j, page);
+      if (page->getRecord(rid[j - 1]) != "checkpoint") {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+      other.unPinPage(file1, j, false);
+    }
+    other.flushFile(file1);
+  }
+  PageId pages = 0;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    pages++;
+  }
+  if (pages != num) {
+    PRINT_ERROR("ERROR :: FILE PAGE LIST WAS DAMAGED");
+  }
+
+  for (PageId j = 1; j <= num; j++) {
+    mgr.readPage(file1, j, page);
+    page->deleteRecord(rid[j - 1]);
+    mgr.unPinPage(file1, j, true);
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 16 passed"
+            << "\n";
+}
+
+void test17(File &file1, File &file2) {
+  // Statistics count hits, misses, evictions and write-backs per file
+  BufMgr mgr(num / 10);
+  mgr.setScanDetection(0, 0);
+  for (PageId j = 1; j <= num / 10; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.unPinPage(file1, j, j <= num / 20);
+  }
+  for (PageId j = 1; j <= num / 20; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.unPinPage(file1, j, false);
+  }
+  BufStats stats = mgr.getBufStats();
+  if (stats.accesses != num / 10 + num / 20 || stats.hits != num / 20 ||
+      stats.misses != num / 10 || stats.diskreads != num / 10 ||
+      stats.evictions != 0 || stats.diskwrites != 0) {
+    PRINT_ERROR("ERROR :: WRONG BUFFER STATISTICS");
+  }
+
+  // loading file2's pages evicts file1's, which are charged to file1
+  for (PageId j = 1; j <= num / 20; j++) {
+    mgr.readPage(file2, j, page);
+    mgr.unPinPage(file2, j, false);
+  }
+  std::map<std::string, BufStats> byFile = mgr.getBufStatsByFile();
+  const BufStats &stats1 = byFile[file1.filename()];
+  const BufStats &stats2 = byFile[file2.filename()];
+  if (stats1.evictions != num / 20 || stats2.evictions != 0 ||
+      stats2.misses != num / 20 || stats2.victimSearches != num / 20 ||
+      stats2.sweepSteps < num / 20 || stats1.writeBacks > num / 20 ||
+      stats1.diskwrites != stats1.writeBacks) {
+    PRINT_ERROR("ERROR :: WRONG BUFFER STATISTICS");
+  }
+
+  // a full pool is counted against the file that asked for a frame
+  for (PageId j = 1; j <= num / 10; j++) {
+    mgr.readPage(file2, j, page);
+  }
+  try {
+    mgr.readPage(file1, num / 10 + 1, page);
+    PRINT_ERROR(
+        "ERROR :: No more frames left for allocation. Exception should have "
+        "been thrown before execution reaches this point.");
+  } catch (const BufferExceededException &e) {
+  }
+  if (mgr.getBufStatsByFile()[file1.filename()].bufferExceeded != 1) {
+    PRINT_ERROR("ERROR :: WRONG BUFFER STATISTICS");
+  }
+  for (PageId j = 1; j <= num / 10; j++) {
+    mgr.unPinPage(file2, j, false);
+  }
+
+  // counts from another thread are added in, and clearing starts over
+  mgr.clearBufStats();
+  std::thread reader([&mgr, &file2] {
+    Page *p;
+    mgr.readPage(file2, 1, p);
+    mgr.unPinPage(file2, 1, false);
+  });
+  reader.join();
+  stats = mgr.getBufStats();
+  if (stats.accesses != 1 || stats.hits != 1 || stats.misses != 0 ||
+      stats.evictions != 0) {
+    PRINT_ERROR("ERROR :: WRONG BUFFER STATISTICS");
+  }
+  mgr.flushFile(file1);
+  mgr.flushFile(file2);
+
+  std::cout << "Test 17 passed"
+            << "\n";
+}
+
+void test18(File &file1) {
+  // An access trace records the calls in order and reads back the same
+  const std::string tracePath = "test.trace";
+  BufMgr mgr(num / 10);
+  mgr.startTrace(tracePath);
+  mgr.readPage(file1, 1, page);
+  mgr.unPinPage(file1, 1, true);
+  std::vector<PageId> pageIds = {2, 3};
+  std::vector<Page *> pages;
+  mgr.readPages(file1, pageIds, pages);
+  mgr.unPinPages(file1, pageIds, false);
+  // a failed batch records its reads but not the release of its pins
+  try {
+    mgr.readPages(file1, {5, num + 1}, pages);
+    PRINT_ERROR(
+        "ERROR :: Page does not exist. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  mgr.flushFile(file1);
+  mgr.stopTrace();
+  mgr.readPage(file1, 4, page);
+  mgr.unPinPage(file1, 4, false);
+
+  struct Expected {
+    BufTraceOp op;
+    PageId pageNo;
+    bool dirty;
+  };
+  const Expected expected[] = {
+      {BufTraceOp::READ, 1, false},  {BufTraceOp::UNPIN, 1, true},
+      {BufTraceOp::READ, 2, false},  {BufTraceOp::READ, 3, false},
+      {BufTraceOp::UNPIN, 2, false}, {BufTraceOp::UNPIN, 3, false},
+      {BufTraceOp::READ, 5, false},  {BufTraceOp::READ, num + 1, false},
+      {BufTraceOp::FLUSH, 0, false}};
+  {
+    BufTraceReader reader(tracePath);
+    BufTraceEvent event;
+    for (const Expected &e : expected) {
+      if (!reader.next(event) || event.op != e.op ||
+          event.pageNo != e.pageNo || event.dirty != e.dirty ||
+          reader.files()[event.file] != file1.filename()) {
+        PRINT_ERROR("ERROR :: TRACE DID NOT MATCH");
+      }
+    }
+    if (reader.next(event)) {
+      PRINT_ERROR("ERROR :: TRACE DID NOT MATCH");
+    }
+  }
+
+  // a file name too long for the trace is cut, and what follows still reads
+  {
+    BufTraceWriter writer(tracePath);
+    writer.record(BufTraceOp::READ,
+                  std::string(BufTraceWriter::MAX_NAME + 1, 'x'), 1);
+    writer.record(BufTraceOp::UNPIN, file1.filename(), 2, true);
+    writer.close();
+  }
+  {
+    BufTraceReader reader(tracePath);
+    BufTraceEvent event;
+    if (!reader.next(event) || event.pageNo != 1 ||
+        reader.files()[event.file].size() != BufTraceWriter::MAX_NAME ||
+        !reader.next(event) || event.op != BufTraceOp::UNPIN ||
+        event.pageNo != 2 || !event.dirty ||
+        reader.files()[event.file] != file1.filename() || reader.next(event)) {
+      PRINT_ERROR("ERROR :: TRACE DID NOT MATCH");
+    }
+  }
+
+  // a trace that could not be written is reported when it is stopped
+  mgr.startTrace("/dev/full");
+  mgr.readPage(file1, 1, page);
+  mgr.unPinPage(file1, 1, false);
+  try {
+    mgr.stopTrace();
+    PRINT_ERROR(
+        "ERROR :: Disk is full. Exception should have been thrown before "
+        "execution reaches this point.");
+  } catch (const FileIOException &e) {
+  }
+  mgr.flushFile(file1);
+  std::remove(tracePath.c_str());
+
+  std::cout << "Test 18 passed"
+            << "\n";
+}
+
+void test19(File &file1) {
+  // Looping over more pages than fit in the pool misses every time, but the
+  // estimated miss ratio curve shows that a pool twice as large would hit
+  BufMgr mgr(num / 4);
+  mgr.setScanDetection(0, 0);
+  mgr.setMissRatioSampling(1.0, 1024);
+  for (int pass = 0; pass < 10; pass++) {
+    for (PageId j = 1; j <= num / 2; j++) {
+      mgr.readPage(file1, j, page);
+      mgr.unPinPage(file1, j, false);
+    }
+  }
+  std::vector<MissRatioPoint> curve = mgr.getMissRatioCurve();
+  if (curve.size() != 6 || curve[1].frames != num / 4 ||
+      curve[3].frames != num / 2 || curve[1].hitRatio != 0 ||
+      curve[3].hitRatio < 0.89 || curve[3].hitRatio > 0.91 ||
+      curve[5].hitRatio != curve[3].hitRatio) {
+    PRINT_ERROR("ERROR :: WRONG MISS RATIO CURVE");
+  }
+
+  // clearing forgets the distances but not the pages
+  mgr.clearBufStats();
+  for (PageId j = 1; j <= num / 2; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.unPinPage(file1, j, false);
+  }
+  if (mgr.predictHitRatio(num / 2) != 1.0) {
+    PRINT_ERROR("ERROR :: WRONG MISS RATIO CURVE");
+  }
+  mgr.flushFile(file1);
+
+  std::cout << "Test 19 passed"
+            << "\n";
+}
+
+void test20(File &file1) {
+  // The try* calls report failures through their return value
+  BufHashTbl table(7);
+  FrameId frame;
+  if (!table.tryInsert(file1, 1, 3) || table.tryInsert(file1, 1, 4) ||
+      !table.tryLookup(file1, 1, frame) || frame != 3 ||
+      table.tryLookup(file1, 2, frame) || !table.tryRemove(file1, 1) ||
+      table.tryRemove(file1, 1)) {
+    PRINT_ERROR("ERROR :: WRONG HASH TABLE RESULT");
+  }
+
+  BufMgr mgr(num / 10);
+  for (PageId j = 1; j <= num / 10; j++) {
+    if (mgr.tryReadPage(file1, j, page) != BufResult::OK) {
+      PRINT_ERROR("ERROR :: PAGE WAS NOT READ");
+    }
+  }
+  PageId pageNo;
+  if (mgr.tryReadPage(file1, num / 10 + 1, page) !=
+          BufResult::BUFFER_EXCEEDED ||
+      mgr.tryAllocPage(file1, pageNo, page) != BufResult::BUFFER_EXCEEDED) {
+    PRINT_ERROR("ERROR :: BUFFER POOL SHOULD BE FULL");
+  }
+  for (PageId j = 1; j <= num / 10; j++) {
+    mgr.unPinPage(file1, j, false);
+  }
+  if (mgr.tryUnPinPage(file1, 1, false) != BufResult::PAGE_NOT_PINNED ||
+      mgr.tryUnPinPage(file1, num / 10 + 1, false) !=
+          BufResult::PAGE_NOT_RESIDENT) {
+    PRINT_ERROR("ERROR :: WRONG UNPIN RESULT");
+  }
+  mgr.flushFile(file1);
+
+  PageId pages = 0;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    pages++;
+  }
+  if (pages != num) {
+    PRINT_ERROR("ERROR :: FAILED ALLOCATION LEFT A PAGE BEHIND");
+  }
+
+  std::cout << "Test 20 passed"
+            << "\n";
+}
+
+void test21(File &file1) {
+  // Optimistic reads see the page until it is written or leaves its frame
+  BufMgr mgr(num / 10);
+  mgr.readPage(file1, 1, page);
+  rid[0] = page->insertRecord("optimistic");
+  mgr.unPinPage(file1, 1, true);
+
+  std::string record;
+  auto reader = [&record](const Page &p) { record = p.getRecord(rid[0]); };
+  OptimisticRef ref;
+  if (mgr.readOptimistic(ref, reader) || !mgr.optimisticRef(file1, 1, ref) ||
+      !mgr.readOptimistic(ref, reader) || record != "optimistic") {
+    PRINT_ERROR("ERROR :: OPTIMISTIC READ FAILED");
+  }
+
+  mgr.readPage(file1, 1, page);
+  mgr.beginWrite(page);
+  if (mgr.readOptimistic(ref, reader) || mgr.optimisticRef(file1, 1, ref)) {
+    PRINT_ERROR("ERROR :: OPTIMISTIC READ SHOULD HAVE FAILED");
+  }
+  page->updateRecord(rid[0], "rewritten");
+  mgr.endWrite(page);
+  mgr.unPinPage(file1, 1, true);
+  if (mgr.readOptimistic(ref, reader) || !mgr.optimisticRef(file1, 1, ref) ||
+      !mgr.readOptimistic(ref, reader) || record != "rewritten") {
+    PRINT_ERROR("ERROR :: OPTIMISTIC READ FAILED");
+  }
+
+  // once the page is evicted, readShared() falls back to reading it in
+  for (PageId j = 2; j <= num / 10 + 1; j++) {
+    mgr.readPage(file1, j, page2);
+    mgr.unPinPage(file1, j, false);
+  }
+  if (mgr.readOptimistic(ref, reader)) {
+    PRINT_ERROR("ERROR :: OPTIMISTIC READ SHOULD HAVE FAILED");
+  }
+  record.clear();
+  mgr.readShared(file1, 1, ref, reader);
+  if (record != "rewritten" || !mgr.readOptimistic(ref, reader)) {
+    PRINT_ERROR("ERROR :: OPTIMISTIC READ FAILED");
+  }
+
+  // concurrent readers share the page without pinning it
+  std::vector<std::thread> threads;
+  std::atomic<int> mismatches(0);
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&mgr, &file1, &mismatches] {
+      OptimisticRef local;
+      std::string seen;
+      for (int i = 0; i < 1000; i++) {
+        mgr.readShared(file1, 1, local, [&seen](const Page &p) {
+          seen = p.getRecord(rid[0]);
+        });
+        if (seen != "rewritten") {
+          mismatches++;
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (mismatches != 0) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  mgr.readPage(file1, 1, page);
+  page->deleteRecord(rid[0]);
+  mgr.unPinPage(file1, 1, true);
+  mgr.flushFile(file1);
+
+  std::cout << "Test 21 passed"
+            << "\n";
+}
+
+void test22(File &file1) {
+  // Swizzled references hit without a hash table lookup until their page
+  // leaves the pool
+  BufMgr mgr(num / 10);
+  std::vector<std::unique_ptr<SwizzledPageRef>> chain;
+  chain.emplace_back(new SwizzledPageRef(file1, 1));
+  for (int i = 0; i < 5; i++) {
+    SwizzledPageRef &ref = *chain.back();
+    mgr.readPage(ref, page);
+    if (!ref.isSwizzled() || page->page_number() != ref.page_number() ||
+        page->next_page_number() == Page::INVALID_NUMBER) {
+      PRINT_ERROR("ERROR :: PAGE REFERENCE NOT SWIZZLED");
+    }
+    chain.emplace_back(new SwizzledPageRef(file1, page->next_page_number()));
+    mgr.unPinPage(ref, false);
+  }
+  chain.pop_back();
+
+  // following the chain again hits through the swizzled frames
+  BufStats before = mgr.getBufStats();
+  for (auto &ref : chain) {
+    mgr.readPage(*ref, page2);
+    if (page2->page_number() != ref->page_number()) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    mgr.unPinPage(*ref, false);
+  }
+  BufStats after = mgr.getBufStats();
+  if (after.hits - before.hits != chain.size() ||
+      after.misses != before.misses) {
+    PRINT_ERROR("ERROR :: SWIZZLED READS DID NOT HIT");
+  }
+
+  // the pin taken through a reference is the pin of the page
+  mgr.readPage(*chain[0], page);
+  mgr.unPinPage(file1, chain[0]->page_number(), false);
+  try {
+    mgr.unPinPage(*chain[0], false);
+    PRINT_ERROR("ERROR :: PAGE SHOULD NOT BE PINNED");
+  } catch (const PageNotPinnedException &e) {
+  }
+
+  // destroying a swizzled reference deregisters it
+  chain.pop_back();
+
+  // evicting the pages unswizzles the references
+  for (PageId j = num / 2; j <= num / 2 + num / 10; j++) {
+    mgr.readPage(file1, j, page);
+    mgr.unPinPage(file1, j, false);
+  }
+  for (auto &ref : chain) {
+    if (ref->isSwizzled()) {
+      PRINT_ERROR("ERROR :: EVICTED PAGE STILL SWIZZLED");
+    }
+  }
+  mgr.readPage(*chain[0], page);
+  if (!chain[0]->isSwizzled() ||
+      page->page_number() != chain[0]->page_number()) {
+    PRINT_ERROR("ERROR :: PAGE REFERENCE NOT SWIZZLED");
+  }
+  mgr.unPinPage(*chain[0], false);
+
+  // flushing the file drops its pages and unswizzles their references
+  SwizzledPageRef flushed(file1, chain[1]->page_number());
+  mgr.readPage(flushed, page);
+  mgr.unPinPage(flushed, false);
+  mgr.flushFile(file1);
+  if (flushed.isSwizzled() || chain[0]->isSwizzled()) {
+    PRINT_ERROR("ERROR :: FLUSHED PAGE STILL SWIZZLED");
+  }
+
+  std::cout << "Test 22 passed"
+            << "\n";
+}
+
+void test23(File &file1, File &file2) {
+  // Files are identified by the number their name is given when opened
+  File again = File::open(file1.filename());
+  File copy = file2;
+  if (again.id() != file1.id() || !(again == file1) || copy.id() != file2.id() ||
+      file1.id() == file2.id() || file1 == file2 || File().id() != 0) {
+    PRINT_ERROR("ERROR :: FILE NUMBERS DID NOT MATCH");
+  }
+
+  // the same page number of two files maps to two frames
+  bufMgr->readPage(file1, 1, page);
+  bufMgr->readPage(file2, 1, page2);
+  if (page == page2) {
+    PRINT_ERROR("ERROR :: FILES SHARE A FRAME");
+  }
+  Page *page3;
+  bufMgr->readPage(again, 1, page3);
+  if (page3 != page) {
+    PRINT_ERROR("ERROR :: SAME PAGE READ INTO TWO FRAMES");
+  }
+  bufMgr->unPinPage(again, 1, false);
+  bufMgr->unPinPage(file1, 1, false);
+  bufMgr->unPinPage(file2, 1, false);
+  bufMgr->flushFile(again);
+  bufMgr->flushFile(file2);
+
+  std::cout << "Test 23 passed"
+            << "\n";
+}
+
+void test24(File &file1, File &file2) {
+  // The page table agrees with a reference map through inserts, removals,
+  // growth and incremental resizes
+  BufHashTbl table(4);
+  std::map<std::pair<FileId, PageId>, FrameId> expected;
+  File *files[2] = {&file1, &file2};
+  std::uint32_t state = 12345;
+  for (int i = 0; i < 20000; i++) {
+    state = state * 1103515245 + 12345;
+    File &file = *files[(state >> 8) & 1];
+    const PageId pageNo = (state >> 9) % 500;
+    const auto entry = std::make_pair(file.id(), pageNo);
+    const bool present = expected.count(entry) > 0;
+    FrameId frame = 0;
+    switch ((state >> 24) % 4) {
+      case 0:
+      case 1:
+        if (table.tryInsert(file, pageNo, i) == present) {
+          PRINT_ERROR("ERROR :: WRONG HASH TABLE RESULT");
+        }
+        if (!present) {
+          expected[entry] = i;
+        }
+        break;
+      case 2:
+        if (table.tryRemove(file, pageNo) != present) {
+          PRINT_ERROR("ERROR :: WRONG HASH TABLE RESULT");
+        }
+        expected.erase(entry);
+        break;
+      default:
+        if (table.tryLookup(file, pageNo, frame) != present ||
+            (present && frame != expected[entry])) {
+          PRINT_ERROR("ERROR :: WRONG HASH TABLE RESULT");
+        }
+    }
+    if (i % 3000 == 0) {
+      table.resize(((state >> 4) % 3 + 1) * 200);
+    }
+  }
+  for (const auto &e : expected) {
+    FrameId frame = 0;
+    if (!table.tryLookup(*files[e.first.first == file1.id() ? 0 : 1],
+                         e.first.second, frame) ||
+        frame != e.second) {
+      PRINT_ERROR("ERROR :: WRONG HASH TABLE RESULT");
+    }
+  }
+
+  std::cout << "Test 24 passed"
+            << "\n";
+}
+
+void test25(File &file1, File &file2) {
+  // Lookups see every page that stays in the concurrent table while other
+  // threads insert, remove and resize
+  ConcurrentPageTable table(16);
+  for (PageId j = 1; j <= 200; j++) {
+    if (!table.insert(file1, j, j + 1000)) {
+      PRINT_ERROR("ERROR :: WRONG PAGE TABLE RESULT");
+    }
+  }
+  if (table.insert(file1, 1, 5) || table.size() != 200) {
+    PRINT_ERROR("ERROR :: WRONG PAGE TABLE RESULT");
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 3; t++) {
+    threads.emplace_back([&table, &file1, &done, &wrong] {
+      while (!done) {
+        for (PageId j = 1; j <= 200; j++) {
+          FrameId frame = 0;
+          if (!table.lookup(file1, j, frame) || frame != j + 1000) {
+            wrong++;
+          }
+        }
+      }
+    });
+  }
+  for (int t = 0; t < 2; t++) {
+    threads.emplace_back([&table, &file2, &wrong, t] {
+      for (int round = 0; round < 200; round++) {
+        for (PageId j = 1; j <= 50; j++) {
+          if (!table.insert(file2, t * 100 + j, j)) {
+            wrong++;
+          }
+        }
+        for (PageId j = 1; j <= 50; j++) {
+          FrameId frame = 0;
+          if (!table.lookup(file2, t * 100 + j, frame) || frame != j ||
+              !table.remove(file2, t * 100 + j)) {
+            wrong++;
+          }
+        }
+      }
+    });
+  }
+  for (std::uint32_t buckets = 32; buckets <= 1024; buckets *= 2) {
+    table.resize(buckets);
+    std::this_thread::yield();
+  }
+  for (std::size_t t = 3; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  done = true;
+  for (std::size_t t = 0; t < 3; t++) {
+    threads[t].join();
+  }
+  FrameId frame;
+  if (wrong != 0 || table.size() != 200 || table.lookup(file2, 1, frame) ||
+      !table.remove(file1, 1) || table.remove(file1, 1)) {
+    PRINT_ERROR("ERROR :: WRONG PAGE TABLE RESULT");
+  }
+
+  std::cout << "Test 25 passed"
+            << "\n";
+}
+
+void test26(File &file1) {
+  // a page read in place is the page read by value
+  Page inPlace;
+  inPlace.insertRecord("overwritten");
+  file1.readPage(2, inPlace);
+  const Page copy = file1.readPage(2);
+  if (std::memcmp(&inPlace, &copy, Page::SIZE) != 0) {
+    PRINT_ERROR("ERROR :: PAGE READ IN PLACE DIFFERS");
+  }
+  try {
+    file1.readPage(Page::INVALID_NUMBER - 1, inPlace);
+    PRINT_ERROR(
+        "ERROR :: Page past the end of the file. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+
+  // allocated pages are laid out in their frames as they are in the file,
+  // both a reused free page in the middle of the file and a new one
+  bufMgr->disposePage(file1, 2);
+  PageId reused, added;
+  bufMgr->allocPage(file1, reused, page);
+  bufMgr->allocPage(file1, added, page2);
+  const Page reusedOnDisk = file1.readPage(reused);
+  const Page addedOnDisk = file1.readPage(added);
+  if (reused != 2 || page->page_number() != 2 ||
+      page->next_page_number() == Page::INVALID_NUMBER ||
+      std::memcmp(page, &reusedOnDisk, Page::SIZE) != 0 ||
+      page2->page_number() != added ||
+      std::memcmp(page2, &addedOnDisk, Page::SIZE) != 0) {
+    PRINT_ERROR("ERROR :: ALLOCATED PAGE DIFFERS FROM THE FILE");
+  }
+  bufMgr->unPinPage(file1, reused, false);
+  bufMgr->unPinPage(file1, added, false);
+  bufMgr->flushFile(file1);
+
+  // copies of the pages read before a page is allocated, and written back
+  // after, keep the next page pointer that links in the new page, and a copy
+  // of a page read before it is deleted cannot be written
+  std::vector<Page> copies;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    copies.push_back(*iter);
+  }
+  const Page linked = file1.allocatePage();
+  std::vector<const Page *> stale;
+  for (const Page &copy : copies) {
+    stale.push_back(&copy);
+  }
+  file1.writePages(stale);
+  bool found = false;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    found = found || (*iter).page_number() == linked.page_number();
+  }
+  if (!found) {
+    PRINT_ERROR("ERROR :: WRITING STALE PAGES UNLINKED A NEW PAGE");
+  }
+  file1.deletePage(linked.page_number());
+  try {
+    file1.writePage(linked);
+    PRINT_ERROR(
+        "ERROR :: Page is deleted. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+
+  std::cout << "Test 26 passed"
+            << "\n";
+}
+
+void test27(File &file3) {
+  // Threads allocate, write and read back pages of one file at once, some
+  // page by page and some in runs, through copies sharing its descriptor
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&file3, &wrong, t] {
+      File file = file3;
+      std::vector<Page> pages;
+      for (int j = 0; j < 8; j++) {
+        pages.push_back(file.allocatePage());
+      }
+      for (int round = 0; round < 20; round++) {
+        const std::string record =
+            std::to_string(t) + "/" + std::to_string(round);
+        std::vector<RecordId> rids;
+        std::vector<const Page *> batch;
+        for (Page &p : pages) {
+          rids.push_back(p.insertRecord(record));
+          batch.push_back(&p);
+          if (t % 2 == 0) {
+            file.writePage(p);
+          }
+        }
+        if (t % 2 == 1) {
+          file.writePages(batch);
+        }
+        for (std::size_t j = 0; j < pages.size(); j++) {
+          Page back;
+          file.readPage(pages[j].page_number(), back);
+          if (back.getRecord(rids[j]) != record) {
+            wrong++;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (wrong != 0) {
+    PRINT_ERROR("ERROR :: CONCURRENT FILE I/O LOST A WRITE");
+  }
+
+  std::cout << "Test 27 passed"
+            << "\n";
+}
+
+void test28(File &file3) {
+  // Pages are written and read through io_uring, where the kernel has it,
+  // and through threads, with more requests than the engines keep in flight
+  for (int useUring = 0; useUring < 2; useUring++) {
+    std::unique_ptr<IoEngine> io = IoEngine::create(8, useUring);
+    std::vector<Page> pages(40);
+    std::vector<RecordId> rids;
+    std::vector<const Page *> written;
+    for (Page &p : pages) {
+      p = file3.allocatePage();
+      rids.push_back(p.insertRecord("first"));
+      written.push_back(&p);
+    }
+    // one run of consecutive pages, then a write of every other page
+    file3.writePages(*io, written);
+    written.clear();
+    for (std::size_t j = 0; j < pages.size(); j += 2) {
+      pages[j].updateRecord(rids[j], "second");
+      written.push_back(&pages[j]);
+    }
+    file3.writePages(*io, written);
+
+    const PageId deleted = file3.allocatePage().page_number();
+    file3.deletePage(deleted);
+    std::vector<PageId> pageIds;
+    std::vector<Page> read(pages.size() + 2);
+    std::vector<Page *> dests;
+    for (std::size_t j = 0; j < read.size(); j++) {
+      pageIds.push_back(j < pages.size() ? pages[j].page_number()
+                        : j == pages.size() ? deleted
+                                            : Page::INVALID_NUMBER - 1);
+      dests.push_back(&read[j]);
+    }
+    std::vector<std::exception_ptr> errors;
+    file3.readPages(*io, pageIds, dests, errors);
+    for (std::size_t j = 0; j < pages.size(); j++) {
+      if (errors[j] ||
+          read[j].getRecord(rids[j]) != (j % 2 == 0 ? "second" : "first")) {
+        PRINT_ERROR("ERROR :: PAGE READ THROUGH THE I/O ENGINE DIFFERS");
+      }
+    }
+    for (std::size_t j = pages.size(); j < read.size(); j++) {
+      try {
+        if (errors[j]) {
+          std::rethrow_exception(errors[j]);
+        }
+        PRINT_ERROR(
+            "ERROR :: Page does not exist. Exception should have been "
+            "thrown before execution reaches this point.");
+      } catch (const InvalidPageException &e) {
+      }
+    }
+  }
+
+  std::cout << "Test 28 passed"
+            << "\n";
+}
+
+void test29() {
+  // A file doing direct I/O holds the same pages as one going through the
+  // page cache, whether they are read into and written from the frames of
+  // the pool or pages elsewhere in memory
+  const std::string filename = "test.6";
+  if (File::exists(filename)) {
+    File::remove(filename);
+  }
+  std::vector<PageId> pageIds;
+  std::vector<RecordId> rids;
+  {
+    File direct = File::create(filename, true /* direct */);
+    if (!direct.isDirect() || !File::open(filename, true).isDirect()) {
+      PRINT_ERROR("ERROR :: FILE IS NOT OPEN FOR DIRECT I/O");
+    }
+    try {
+      File::open(filename);
+      PRINT_ERROR(
+          "ERROR :: File is open for direct I/O. Exception should have been "
+          "thrown before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    for (i = 0; i < 20; i++) {
+      bufMgr->allocPage(direct, pageno1, page);
+      sprintf(tmpbuf, "test.6 Page %u", pageno1);
+      rids.push_back(page->insertRecord(tmpbuf));
+      pageIds.push_back(pageno1);
+      bufMgr->unPinPage(direct, pageno1, true);
+    }
+    // new pages are laid out in their frames, not read
+    const BufStats stats = bufMgr->getBufStatsByFile()[filename];
+    if (stats.allocs != 20 || stats.diskreads != 0) {
+      PRINT_ERROR("ERROR :: WRONG BUFFER STATISTICS");
+    }
+    bufMgr->flushFile(direct);
+
+    std::vector<Page *> pages;
+    bufMgr->readPages(direct, pageIds, pages);
+    std::unique_ptr<IoEngine> io = IoEngine::create(8);
+    std::vector<Page> copies(pageIds.size());
+    std::vector<Page *> dests;
+    for (Page &copy : copies) {
+      dests.push_back(&copy);
+    }
+    std::vector<std::exception_ptr> errors;
+    direct.readPages(*io, pageIds, dests, errors);
+    for (std::size_t j = 0; j < pageIds.size(); j++) {
+      sprintf(tmpbuf, "test.6 Page %u", pageIds[j]);
+      const Page copy = direct.readPage(pageIds[j]);
+      if (pages[j]->getRecord(rids[j]) != tmpbuf || errors[j] ||
+          std::memcmp(pages[j], &copy, Page::SIZE) != 0 ||
+          std::memcmp(pages[j], &copies[j], Page::SIZE) != 0) {
+        PRINT_ERROR("ERROR :: PAGE READ WITH DIRECT I/O DIFFERS");
+      }
+    }
+    bufMgr->unPinPages(direct, pageIds, false);
+    bufMgr->flushFile(direct);
+
+    copies[1].updateRecord(rids[1], "changed");
+    direct.writePage(copies[1]);
+    direct.deletePage(pageIds[2]);
+  }
+
+  {
+    File buffered = File::open(filename);
+    if (buffered.isDirect()) {
+      PRINT_ERROR("ERROR :: FILE IS OPEN FOR DIRECT I/O");
+    }
+    for (std::size_t j = 0; j < pageIds.size(); j++) {
+      if (j == 2) {
+        try {
+          buffered.readPage(pageIds[j]);
+          PRINT_ERROR(
+              "ERROR :: Page is deleted. Exception should have been thrown "
+              "before execution reaches this point.");
+        } catch (const InvalidPageException &e) {
+        }
+        continue;
+      }
+      sprintf(tmpbuf, "test.6 Page %u", pageIds[j]);
+      if (buffered.readPage(pageIds[j]).getRecord(rids[j]) !=
+          (j == 1 ? "changed" : tmpbuf)) {
+        PRINT_ERROR("ERROR :: PAGE WRITTEN WITH DIRECT I/O DIFFERS");
+      }
+    }
+  }
+  File::remove(filename);
+
+  // A file created without direct I/O keeps page 1 straight after the
+  // header, and so cannot be opened for direct I/O
+  File::create(filename).allocatePage();
+  {
+    std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+    if (stream.tellg() != std::streamoff(sizeof(FileHeader) + Page::SIZE)) {
+      PRINT_ERROR("ERROR :: FILE IS NOT LAID OUT AS BEFORE");
+    }
+  }
+  try {
+    File::open(filename, true /* direct */);
+    PRINT_ERROR(
+        "ERROR :: File is not laid out for direct I/O. Exception should have "
+        "been thrown before execution reaches this point.");
+  } catch (const FileIOException &e) {
+  }
+  File::remove(filename);
+
+  std::cout << "Test 29 passed"
+            << "\n";
+}
+
+void test30() {
+  // A mapped file is read in place, with a scan walking the pages of the
+  // mapping, and cannot be changed
+  const std::string filename = "test.6";
+  if (File::exists(filename)) {
+    File::remove(filename);
+  }
+  std::vector<PageId> pageIds;
+  std::vector<RecordId> rids;
+  PageId deleted;
+  {
+    File file = File::create(filename);
+    for (i = 0; i < 20; i++) {
+      Page new_page = file.allocatePage();
+      sprintf(tmpbuf, "test.6 Page %u", new_page.page_number());
+      rids.push_back(new_page.insertRecord(tmpbuf));
+      pageIds.push_back(new_page.page_number());
+      file.writePage(new_page);
+    }
+    file.advise(FileAccess::RANDOM);
+    deleted = pageIds[2];
+    file.deletePage(deleted);
+    pageIds.erase(pageIds.begin() + 2);
+    rids.erase(rids.begin() + 2);
+  }
+
+  {
+    File mapped = File::openMapped(filename);
+    if (!mapped.isMapped() || !File::openMapped(filename).isMapped()) {
+      PRINT_ERROR("ERROR :: FILE IS NOT MAPPED");
+    }
+    try {
+      File::open(filename);
+      PRINT_ERROR(
+          "ERROR :: File is mapped. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    mapped.advise(FileAccess::SEQUENTIAL);
+    std::size_t j = 0;
+    for (FileIterator iter = mapped.begin(); iter != mapped.end(); ++iter) {
+      sprintf(tmpbuf, "test.6 Page %u", pageIds[j]);
+      const Page *inPlace = iter.mappedPage();
+      const Page copy = *iter;
+      if (j >= pageIds.size() || inPlace->page_number() != pageIds[j] ||
+          inPlace->getRecord(rids[j]) != tmpbuf ||
+          inPlace != mapped.mappedPage(pageIds[j]) ||
+          std::memcmp(inPlace, &copy, Page::SIZE) != 0) {
+        PRINT_ERROR("ERROR :: MAPPED PAGE DIFFERS");
+      }
+      j++;
+    }
+    if (j != pageIds.size()) {
+      PRINT_ERROR("ERROR :: SCAN OF MAPPED FILE MISSED PAGES");
+    }
+
+    // reads through the engine and into the pool copy out of the mapping
+    std::unique_ptr<IoEngine> io = IoEngine::create(8);
+    std::vector<Page> copies(pageIds.size());
+    std::vector<Page *> dests;
+    for (Page &copy : copies) {
+      dests.push_back(&copy);
+    }
+    std::vector<std::exception_ptr> errors;
+    mapped.readPages(*io, pageIds, dests, errors);
+    bufMgr->readPage(mapped, pageIds[0], page);
+    if (errors[0] || errors.back() ||
+        std::memcmp(&copies.back(), mapped.mappedPage(pageIds.back()),
+                    Page::SIZE) != 0 ||
+        std::memcmp(page, mapped.mappedPage(pageIds[0]), Page::SIZE) != 0) {
+      PRINT_ERROR("ERROR :: PAGE COPIED FROM MAPPING DIFFERS");
+    }
+    bufMgr->unPinPage(mapped, pageIds[0], false);
+    bufMgr->flushFile(mapped);
+
+    try {
+      mapped.mappedPage(deleted);
+      PRINT_ERROR(
+          "ERROR :: Page is deleted. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const InvalidPageException &e) {
+    }
+    try {
+      mapped.mappedPage(Page::INVALID_NUMBER - 1);
+      PRINT_ERROR(
+          "ERROR :: Page past the end of the file. Exception should have been "
+          "thrown before execution reaches this point.");
+    } catch (const InvalidPageException &e) {
+    }
+    try {
+      mapped.allocatePage();
+      PRINT_ERROR(
+          "ERROR :: File is read-only. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    try {
+      mapped.writePage(copies[0]);
+      PRINT_ERROR(
+          "ERROR :: File is read-only. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    try {
+      mapped.deletePage(pageIds[0]);
+      PRINT_ERROR(
+          "ERROR :: File is read-only. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+  }
+
+  {
+    File file = File::open(filename);
+    try {
+      file.mappedPage(pageIds[0]);
+      PRINT_ERROR(
+          "ERROR :: File is not mapped. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 30 passed"
+            << "\n";
+}
+
+void test31() {
+  // The miss ratio curve of a grown pool reaches four times its new size,
+  // past what the pool it started as could predict
+  const std::string filename = "test.7";
+  if (File::exists(filename)) {
+    File::remove(filename);
+  }
+  const PageId pages = 3000;
+  {
+    File file = File::create(filename);
+    BufMgr mgr(256, 1, ReplacementPolicyType::CLOCK, BufWriterConfig(),
+               false /* hugePages */, 1024);
+    mgr.setScanDetection(0, 0);
+    mgr.setMissRatioSampling(1.0, 4096);
+    mgr.resize(1024);
+    for (PageId j = 0; j < pages; j++) {
+      mgr.allocPage(file, pageno1, page);
+      mgr.unPinPage(file, pageno1, true);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+      for (PageId j = 1; j <= pages; j++) {
+        mgr.readPage(file, j, page);
+        mgr.unPinPage(file, j, false);
+      }
+    }
+    // every page is used again after the 2999 others
+    std::vector<MissRatioPoint> curve = mgr.getMissRatioCurve();
+    if (curve.size() != 6 || curve[3].frames != 2048 ||
+        curve[4].frames != 3072 || curve[3].hitRatio != 0 ||
+        curve[4].hitRatio < 0.66 || curve[4].hitRatio > 0.67 ||
+        curve[5].hitRatio != curve[4].hitRatio) {
+      PRINT_ERROR("ERROR :: WRONG MISS RATIO CURVE AFTER RESIZE");
+    }
+  }
+  File::remove(filename);
+
+  std::cout << "Test 31 passed"
+            << "\n";
+}
+
+void test32() {
+  // Objects retired by a thread that has exited are freed by another
+  // thread's collect(), before the manager is destroyed
+  static std::atomic<int> freed(0);
+  EpochManager epochs;
+  std::thread retirer([&epochs]() {
+    for (int j = 0; j < 3; j++) {
+      epochs.retire(new int(j), [](void *p) {
+        delete static_cast<int *>(p);
+        freed++;
+      });
+    }
+  });
+  retirer.join();
+  for (int j = 0; j < 3; j++) {
+    epochs.collect();
+  }
+  if (freed != 3) {
+    PRINT_ERROR("ERROR :: RETIRED OBJECTS WERE NOT FREED");
+  }
+
+  std::cout << "Test 32 passed"
+            << "\n";
+}
@@ -102,8 +102,15 @@
  *  badgerdb::File existing_file = badgerdb::File::open("filename.db");
  * @endcode
  *
- * Multiple File objects share the same stream to the underlying file.  The
- * stream will be automatically closed when the last File object is out of
+ * Passing true as the second argument of either opens the file for direct
+ * I/O, so that its pages are cached by the buffer pool alone rather than by
+ * the operating system as well.  A file that is only read can be opened with
+ * File::openMapped instead, which maps it into memory so that its pages are
+ * read in place.  While a file is open, it can only be opened again the same
+ * way.
+ *
+ * Multiple File objects share the same descriptor of the underlying file.
+ * The file will be automatically closed when the last File object is out of
  * scope; no explicit close command is necessary.
  *
  * You can delete a file with File::remove:
@@ -0,0 +1,217 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "miss_ratio.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+const std::uint32_t MissRatioEstimator::MAX_MULTIPLE;
+const std::uint32_t MissRatioEstimator::NUM_BUCKETS;
+const std::uint32_t MissRatioEstimator::STRIPES;
+const std::uint32_t MissRatioEstimator::STRIPE_SIZE;
+
+namespace {
+
+/**
+ * Returns a number that stays the same for the calling thread, for spreading
+ * threads over buffers.
+ */
+std::uint32_t threadNumber() {
+  static std::atomic<std::uint32_t> next(0);
+  thread_local const std::uint32_t number =
+      next.fetch_add(1, std::memory_order_relaxed);
+  return number;
+}
+
+}  // namespace
+
+MissRatioEstimator::MissRatioEstimator(std::uint32_t frames, double rate,
+                                       std::uint32_t maxSamples)
+    : threshold(0),
+      bucketWidth(std::max<std::uint64_t>(
+          1, (std::uint64_t(frames) * MAX_MULTIPLE + NUM_BUCKETS - 1) /
+                 NUM_BUCKETS)) {
+  std::lock_guard<std::mutex> lock(mutex);
+  reset(rate, maxSamples);
+}
+
+void MissRatioEstimator::configure(double rate, std::uint32_t maxSamples) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // empty the buffers; what they held is forgotten by reset()
+  drain();
+  reset(rate, maxSamples);
+}
+
+void MissRatioEstimator::reset(double rate, std::uint32_t maxSamples) {
+  const double range = double(1u << HASH_BITS);
+  rate = std::min(1.0, std::max(0.0, rate));
+  threshold = static_cast<std::uint32_t>(rate * range);
+  this->maxSamples = std::max(1u, maxSamples);
+  samples.clear();
+  byHash = decltype(byHash)();
+  // room for every tracked page plus as many accesses again before compact()
+  tree.assign(2 * std::size_t(this->maxSamples) + 2, 0);
+  now = 1;
+  histogram.assign(NUM_BUCKETS + 1, 0.0);
+  total = 0;
+}
+
+void MissRatioEstimator::cover(std::uint32_t frames) {
+  std::lock_guard<std::mutex> lock(mutex);
+  drain();
+  while (std::uint64_t(bucketWidth) * NUM_BUCKETS <
+         std::uint64_t(frames) * MAX_MULTIPLE) {
+    // bucket b takes in buckets 2b and 2b+1; the overflow bucket stays last
+    for (std::uint32_t b = 0; b < NUM_BUCKETS / 2; b++) {
+      histogram[b] = histogram[2 * b] + histogram[2 * b + 1];
+    }
+    std::fill(histogram.begin() + NUM_BUCKETS / 2, histogram.end() - 1, 0.0);
+    bucketWidth *= 2;
+  }
+}
+
+void MissRatioEstimator::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  drain();
+  histogram.assign(NUM_BUCKETS + 1, 0.0);
+  total = 0;
+}
+
+void MissRatioEstimator::enqueue(std::uint64_t key) {
+  Stripe& stripe = stripes[threadNumber() % STRIPES];
+  const std::uint32_t tail = stripe.tail.load(std::memory_order_acquire);
+  std::uint32_t head = stripe.head.load(std::memory_order_relaxed);
+  // the slot is free once tail has passed it; a key is dropped if its buffer
+  // is full or another thread claims the slot first
+  if (key != 0 && head - tail < STRIPE_SIZE &&
+      stripe.head.compare_exchange_strong(head, head + 1,
+                                          std::memory_order_relaxed)) {
+    stripe.slots[head % STRIPE_SIZE].store(key, std::memory_order_release);
+    head++;
+  }
+  if (head - tail >= STRIPE_SIZE / 2 && mutex.try_lock()) {
+    std::lock_guard<std::mutex> lock(mutex, std::adopt_lock);
+    drain();
+  }
+}
+
+void MissRatioEstimator::drain() {
+  for (Stripe& stripe : stripes) {
+    const std::uint32_t head = stripe.head.load(std::memory_order_acquire);
+    std::uint32_t tail = stripe.tail.load(std::memory_order_relaxed);
+    for (; tail != head; tail++) {
+      const std::uint64_t key = stripe.slots[tail % STRIPE_SIZE].exchange(
+          0, std::memory_order_acquire);
+      if (key == 0) {
+        // claimed but not yet written; taken in by a later drain
+        break;
+      }
+      sample(key);
+    }
+    stripe.tail.store(tail, std::memory_order_release);
+  }
+}
+
+void MissRatioEstimator::sample(std::uint64_t key) {
+  const std::uint32_t hash = key >> (64 - HASH_BITS);
+  if (hash >= threshold) {
+    // the threshold was lowered meanwhile
+    return;
+  }
+
+  // every sampled access stands for 1 / rate accesses
+  const double weight = double(1u << HASH_BITS) / threshold;
+  total += weight;
+
+  auto it = samples.find(key);
+  if (it == samples.end()) {
+    it = samples.emplace(key, Sample{hash, 0}).first;
+    byHash.push(std::make_pair(hash, key));
+  } else {
+    const std::uint32_t distance =
+        countUpTo(now - 1) - countUpTo(it->second.time);
+    const double scaled = distance * weight;
+    const std::size_t bucket =
+        std::min<double>(NUM_BUCKETS, scaled / bucketWidth);
+    histogram[bucket] += weight;
+    add(it->second.time, -1);
+    it->second.time = 0;
+  }
+
+  if (now >= tree.size()) {
+    compact();
+  }
+  it->second.time = now++;
+  add(it->second.time, 1);
+
+  // drop the pages with the largest hashes and sample below them from now on
+  while (samples.size() > maxSamples) {
+    const std::uint32_t top = byHash.top().first;
+    while (!byHash.empty() && byHash.top().first >= top) {
+      auto dropped = samples.find(byHash.top().second);
+      add(dropped->second.time, -1);
+      samples.erase(dropped);
+      byHash.pop();
+    }
+    threshold = top;
+  }
+}
+
+double MissRatioEstimator::hitRatio(std::uint32_t frames) {
+  std::lock_guard<std::mutex> lock(mutex);
+  drain();
+  if (total == 0) {
+    return 0;
+  }
+  // a page hits if fewer than frames other pages were used since its last
+  // access
+  const std::uint32_t buckets = std::min(NUM_BUCKETS, frames / bucketWidth);
+  double hits = 0;
+  for (std::uint32_t b = 0; b < buckets; b++) {
+    hits += histogram[b];
+  }
+  return std::min(1.0, hits / total);
+}
+
+std::uint32_t MissRatioEstimator::countUpTo(std::uint32_t time) const {
+  std::int32_t count = 0;
+  for (; time > 0; time -= time & -time) {
+    count += tree[time];
+  }
+  return count;
+}
+
+void MissRatioEstimator::add(std::uint32_t time, int delta) {
+  for (; time < tree.size(); time += time & -time) {
+    tree[time] += delta;
+  }
+}
+
+void MissRatioEstimator::compact() {
+  std::vector<std::pair<std::uint32_t, Sample*>> live;
+  for (auto& s : samples) {
+    if (s.second.time != 0) {
+      live.push_back(std::make_pair(s.second.time, &s.second));
+    }
+  }
+  std::sort(live.begin(), live.end(),
+            [](const std::pair<std::uint32_t, Sample*>& a,
+               const std::pair<std::uint32_t, Sample*>& b) {
+              return a.first < b.first;
+            });
+  std::fill(tree.begin(), tree.end(), 0);
+  now = 1;
+  for (auto& entry : live) {
+    entry.second->time = now++;
+    add(entry.second->time, 1);
+  }
+}
+
+}  // namespace badgerdb
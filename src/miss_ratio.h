@@ -0,0 +1,281 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Predicted hit ratio of a buffer pool of a given size.
+ */
+struct MissRatioPoint {
+  /**
+   * Number of frames of the pool
+   */
+  std::uint32_t frames;
+
+  /**
+   * Fraction of accesses predicted to hit in the pool, between 0 and 1
+   */
+  double hitRatio;
+};
+
+/**
+ * @brief Online estimate of the miss ratio curve of an LRU buffer pool.
+ *
+ * Uses spatially hashed sampling (SHARDS): only pages whose key hashes below
+ * a threshold are tracked, and the reuse distance measured among the sampled
+ * pages is scaled up by the inverse of the sampling rate.  Accesses to pages
+ * that are not sampled cost a shift and a compare.  The number of tracked
+ * pages is bounded; when it is exceeded the threshold is lowered and the
+ * pages above it are dropped, so the rate adapts to the working set.
+ *
+ * Accesses to sampled pages take no lock either: the key is queued in one of
+ * STRIPES small buffers, picked by thread, and whichever thread finds its
+ * buffer half full drains all of them if no other thread is doing so.  A key
+ * is dropped if its buffer is full.  hitRatio() drains the buffers first.
+ *
+ * Reuse distances are recorded in a histogram of fixed width buckets that
+ * covers MAX_MULTIPLE times the pool size given at construction.  cover()
+ * widens the buckets, merging them in pairs, when the pool grows.
+ *
+ * The class is threadsafe.
+ */
+class MissRatioEstimator {
+ public:
+  /**
+   * Largest multiple of the pool size that predictions are made for
+   */
+  static const std::uint32_t MAX_MULTIPLE = 8;
+
+  /**
+   * Constructor of MissRatioEstimator class
+   *
+   * @param frames      Number of frames of the pool being modelled
+   * @param rate        Initial sampling rate, between 0 and 1
+   * @param maxSamples  Maximum number of pages tracked at a time
+   */
+  MissRatioEstimator(std::uint32_t frames, double rate = 1.0 / 32,
+                     std::uint32_t maxSamples = 4096);
+
+  MissRatioEstimator(const MissRatioEstimator&) = delete;
+  MissRatioEstimator& operator=(const MissRatioEstimator&) = delete;
+
+  /**
+   * Record an access to a page.
+   *
+   * @param key   Page key of the page; its upper bits decide sampling
+   */
+  void access(std::uint64_t key) {
+    if ((key >> (64 - HASH_BITS)) < threshold.load(std::memory_order_relaxed)) {
+      enqueue(key);
+    }
+  }
+
+  /**
+   * Returns the fraction of the accesses since the last clear() that would
+   * have hit in an LRU pool of the given size, or 0 if there were none.
+   *
+   * @param frames  Number of frames of the pool
+   */
+  double hitRatio(std::uint32_t frames);
+
+  /**
+   * Widen the histogram buckets as needed for predictions at up to
+   * MAX_MULTIPLE times the given pool size.  The buckets are never narrowed.
+   *
+   * @param frames  Number of frames of the pool
+   */
+  void cover(std::uint32_t frames);
+
+  /**
+   * Forget the recorded reuse distances, keeping the pages tracked so that
+   * their next accesses are not mistaken for first accesses.
+   */
+  void clear();
+
+  /**
+   * Forget everything and start sampling at the given rate.
+   *
+   * @param rate        Sampling rate, between 0 and 1
+   * @param maxSamples  Maximum number of pages tracked at a time
+   */
+  void configure(double rate, std::uint32_t maxSamples);
+
+ private:
+  /**
+   * Number of key bits compared against threshold
+   */
+  static const int HASH_BITS = 24;
+
+  /**
+   * Number of histogram buckets, not counting the overflow bucket
+   */
+  static const std::uint32_t NUM_BUCKETS = 1024;
+
+  /**
+   * Number of buffers that sampled keys are queued in
+   */
+  static const std::uint32_t STRIPES = 16;
+
+  /**
+   * Number of keys a buffer holds, a power of two
+   */
+  static const std::uint32_t STRIPE_SIZE = 64;
+
+  /**
+   * A buffer of sampled keys waiting to be taken in, filled by any number of
+   * threads and drained under mutex.  Its positions count up forever and
+   * wrap around the slots.
+   */
+  struct Stripe {
+    Stripe() : head(0), tail(0) {
+      for (std::atomic<std::uint64_t>& slot : slots) {
+        slot.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    /**
+     * Next position to be claimed by a thread queueing a key
+     */
+    std::atomic<std::uint32_t> head;
+
+    /**
+     * Next position to be drained; only changed under mutex
+     */
+    std::atomic<std::uint32_t> tail;
+
+    /**
+     * Queued keys; 0 marks a slot that is empty, or claimed but not yet
+     * written
+     */
+    std::atomic<std::uint64_t> slots[STRIPE_SIZE];
+  };
+
+  /**
+   * A tracked page.
+   */
+  struct Sample {
+    /**
+     * Upper bits of the page key
+     */
+    std::uint32_t hash;
+
+    /**
+     * Time slot of the last access, or 0 while it is being moved
+     */
+    std::uint32_t time;
+  };
+
+  /**
+   * Queue an access to a sampled page, draining the buffers if they are
+   * filling up and no other thread holds mutex.
+   */
+  void enqueue(std::uint64_t key);
+
+  /**
+   * Take in the queued accesses.  The caller must hold mutex.
+   */
+  void drain();
+
+  /**
+   * Record an access to a sampled page.  The caller must hold mutex.
+   */
+  void sample(std::uint64_t key);
+
+  /**
+   * Number of accesses in time slots 1 to time.  The caller must hold mutex.
+   */
+  std::uint32_t countUpTo(std::uint32_t time) const;
+
+  /**
+   * Add delta at a time slot.  The caller must hold mutex.
+   */
+  void add(std::uint32_t time, int delta);
+
+  /**
+   * Renumber the time slots of the tracked pages from 1, keeping their
+   * order.  The caller must hold mutex.
+   */
+  void compact();
+
+  /**
+   * Reset all state.  The caller must hold mutex.
+   */
+  void reset(double rate, std::uint32_t maxSamples);
+
+  /**
+   * Pages are sampled if the upper HASH_BITS bits of their key are below
+   * this.  The sampling rate is threshold / 2^HASH_BITS.
+   */
+  std::atomic<std::uint32_t> threshold;
+
+  /**
+   * Buffers of sampled keys not yet taken in
+   */
+  Stripe stripes[STRIPES];
+
+  /**
+   * Guards all other members
+   */
+  std::mutex mutex;
+
+  /**
+   * Maximum number of tracked pages
+   */
+  std::uint32_t maxSamples;
+
+  /**
+   * Tracked pages by key
+   */
+  std::unordered_map<std::uint64_t, Sample> samples;
+
+  /**
+   * Tracked pages, largest hash first, to drop pages when threshold is
+   * lowered
+   */
+  std::priority_queue<std::pair<std::uint32_t, std::uint64_t>> byHash;
+
+  /**
+   * Fenwick tree over time slots, holding 1 at the last access of every
+   * tracked page; the reuse distance of a page is the number of ones after
+   * its slot
+   */
+  std::vector<std::int32_t> tree;
+
+  /**
+   * Next time slot
+   */
+  std::uint32_t now;
+
+  /**
+   * Width of a histogram bucket in frames
+   */
+  std::uint32_t bucketWidth;
+
+  /**
+   * Estimated number of accesses by reuse distance bucket; the last bucket
+   * holds longer distances
+   */
+  std::vector<double> histogram;
+
+  /**
+   * Estimated number of accesses, including first accesses
+   */
+  double total;
+};
+
+}  // namespace badgerdb
@@ -9,6 +9,7 @@
 #include "page.h"
 
 #include <cassert>
+#include <cstring>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -21,14 +22,22 @@ namespace badgerdb {
 
 Page::Page() { initialize(); }
 
-void Page::initialize() {
-  header_.free_space_lower_bound = 0;
-  header_.free_space_upper_bound = DATA_SIZE;
-  header_.num_slots = 0;
-  header_.num_free_slots = 0;
-  header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+void Page::initialize() { initialize(emptyHeader()); }
+
+void Page::initialize(const PageHeader &header) {
+  header_ = header;
+  std::memset(data_, 0, DATA_SIZE);
+}
+
+PageHeader Page::emptyHeader() {
+  PageHeader header;
+  header.free_space_lower_bound = 0;
+  header.free_space_upper_bound = DATA_SIZE;
+  header.num_slots = 0;
+  header.num_free_slots = 0;
+  header.current_page_number = INVALID_NUMBER;
+  header.next_page_number = INVALID_NUMBER;
+  return header;
 }
 
 RecordId Page::insertRecord(const std::string &record_data) {
@@ -48,7 +57,7 @@ RecordId Page::insertRecord(const std::string &record_data) {
 std::string Page::getRecord(const RecordId &record_id) const {
   validateRecordId(record_id);
   const PageSlot *slot = getSlot(record_id.slot_number);
-  return data_.substr(slot->item_offset, slot->item_length);
+  return std::string(data_ + slot->item_offset, slot->item_length);
 }
 
 void Page::updateRecord(const RecordId &record_id,
@@ -76,7 +85,7 @@ void Page::deleteRecord(const RecordId &record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot *slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  std::memset(data_ + slot->item_offset, 0, slot->item_length);
 
   // Compact the data by removing the hole left by this record (if necessary).
   std::uint16_t move_offset = slot->item_offset;
@@ -95,8 +104,8 @@ void Page::deleteRecord(const RecordId &record_id,
   }
   // If we have data to move, shift it to the right.
   if (move_bytes > 0) {
-    const std::string &data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+    std::memmove(data_ + move_offset + slot->item_length, data_ + move_offset,
+                 move_bytes);
   }
   header_.free_space_upper_bound += slot->item_length;
 
@@ -192,7 +201,7 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(data_ + slot->item_offset, record_data.data(), slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId &record_id) const {
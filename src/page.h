@@ -222,6 +222,18 @@ class Page {
    */
   void initialize();
 
+  /**
+   * Initializes this page as a new page with the given header and no data.
+   *
+   * @param header  Header of the new page.
+   */
+  void initialize(const PageHeader &header);
+
+  /**
+   * Returns the header of a new page with no data and no page numbers.
+   */
+  static PageHeader emptyHeader();
+
   /**
    * Sets this page's number in its file.
    *
@@ -329,12 +341,14 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Stored inline so that a Page is one fixed-size
+   * block of SIZE bytes.
    */
 
-  std::string data_;
+  char data_[DATA_SIZE];
 
   friend class File;
+  friend class BufMgr;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -343,5 +357,7 @@ class Page {
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0, "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be exactly the size of a page on disk.");
 
 }  // namespace badgerdb
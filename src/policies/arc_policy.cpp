@@ -0,0 +1,141 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "policies/arc_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+void ArcPolicy::Ghosts::push(std::uint64_t key) {
+  erase(key);
+  keys.push_front(key);
+  index[key] = keys.begin();
+}
+
+void ArcPolicy::Ghosts::erase(std::uint64_t key) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    keys.erase(it->second);
+    index.erase(it);
+  }
+}
+
+void ArcPolicy::Ghosts::popOldest() {
+  index.erase(keys.back());
+  keys.pop_back();
+}
+
+ArcPolicy::ArcPolicy(std::uint32_t frames)
+    : capacity(frames),
+      target(0),
+      where(frames, NONE),
+      position(frames),
+      keys(frames, 0) {}
+
+void ArcPolicy::unlink(FrameId frame) {
+  if (where[frame] == T1) {
+    t1.erase(position[frame]);
+  } else if (where[frame] == T2) {
+    t2.erase(position[frame]);
+  }
+  where[frame] = NONE;
+}
+
+void ArcPolicy::trimGhosts() {
+  while (!b1.keys.empty() && t1.size() + b1.keys.size() > capacity) {
+    b1.popOldest();
+  }
+  while (!b2.keys.empty() &&
+         t1.size() + t2.size() + b1.keys.size() + b2.keys.size() >
+             2 * capacity) {
+    b2.popOldest();
+  }
+}
+
+void ArcPolicy::recordLoad(FrameId frame, std::uint64_t pageKey) {
+  unlink(frame);
+  keys[frame] = pageKey;
+  if (b1.contains(pageKey) || b2.contains(pageKey)) {
+    b1.erase(pageKey);
+    b2.erase(pageKey);
+    t2.push_front(frame);
+    position[frame] = t2.begin();
+    where[frame] = T2;
+  } else {
+    t1.push_front(frame);
+    position[frame] = t1.begin();
+    where[frame] = T1;
+  }
+  trimGhosts();
+}
+
+void ArcPolicy::recordAccess(FrameId frame) {
+  if (where[frame] == T1) {
+    t1.erase(position[frame]);
+  } else if (where[frame] == T2) {
+    t2.erase(position[frame]);
+  } else {
+    return;
+  }
+  t2.push_front(frame);
+  position[frame] = t2.begin();
+  where[frame] = T2;
+}
+
+void ArcPolicy::recordRemove(FrameId frame) { unlink(frame); }
+
+bool ArcPolicy::evictFrom(std::list<FrameId>& list, Ghosts& ghost,
+                          const EvictablePredicate& evictable,
+                          FrameId& frame) {
+  for (auto it = list.rbegin(); it != list.rend(); ++it) {
+    steps++;
+    if (evictable(*it)) {
+      frame = *it;
+      ghost.push(keys[frame]);
+      unlink(frame);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ArcPolicy::pickVictim(std::uint64_t pageKey,
+                           const EvictablePredicate& evictable,
+                           FrameId& frame) {
+  // A ghost hit means the cache would have kept the page had the list it was
+  // evicted from been larger, so grow that list's share.
+  const bool inB2 = b2.contains(pageKey);
+  if (b1.contains(pageKey)) {
+    std::size_t delta = std::max<std::size_t>(
+        1, b2.keys.size() / std::max<std::size_t>(1, b1.keys.size()));
+    target = std::min(capacity, target + delta);
+  } else if (inB2) {
+    std::size_t delta = std::max<std::size_t>(
+        1, b1.keys.size() / std::max<std::size_t>(1, b2.keys.size()));
+    target = target > delta ? target - delta : 0;
+  }
+
+  if (!t1.empty() && (t1.size() > target || (inB2 && t1.size() == target))) {
+    return evictFrom(t1, b1, evictable, frame) ||
+           evictFrom(t2, b2, evictable, frame);
+  }
+  return evictFrom(t2, b2, evictable, frame) ||
+         evictFrom(t1, b1, evictable, frame);
+}
+
+void ArcPolicy::resize(std::uint32_t frames) {
+  capacity = frames;
+  target = std::min(target, capacity);
+  where.resize(frames, NONE);
+  position.resize(frames);
+  keys.resize(frames, 0);
+  trimGhosts();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,118 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha).
+ *
+ * Resident pages live on T1 (seen once recently) or T2 (seen at least twice).
+ * Keys of pages evicted from them are remembered on the ghost lists B1 and
+ * B2, and a miss that hits a ghost list moves the target size of T1 towards
+ * the list that would have kept the page.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of ArcPolicy class
+   *
+   * @param frames  Number of frames managed by the policy
+   */
+  explicit ArcPolicy(std::uint32_t frames);
+
+  void recordLoad(FrameId frame, std::uint64_t pageKey) override;
+  void recordAccess(FrameId frame) override;
+  void recordRemove(FrameId frame) override;
+  bool pickVictim(std::uint64_t pageKey, const EvictablePredicate& evictable,
+                  FrameId& frame) override;
+  void resize(std::uint32_t frames) override;
+
+ private:
+  /**
+   * List a frame is on
+   */
+  enum List { NONE, T1, T2 };
+
+  /**
+   * Ghost list of page keys, most recently evicted first, with an index
+   */
+  struct Ghosts {
+    std::list<std::uint64_t> keys;
+    std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator>
+        index;
+
+    bool contains(std::uint64_t key) const { return index.count(key) > 0; }
+    void push(std::uint64_t key);
+    void erase(std::uint64_t key);
+    void popOldest();
+  };
+
+  /**
+   * Evict the least recently used evictable frame of a resident list and
+   * remember its key on ghost list.
+   *
+   * @return  False if the list has no evictable frame
+   */
+  bool evictFrom(std::list<FrameId>& list, Ghosts& ghost,
+                 const EvictablePredicate& evictable, FrameId& frame);
+
+  /**
+   * Unlink frame from whichever resident list it is on.
+   */
+  void unlink(FrameId frame);
+
+  /**
+   * Trim the ghost lists to the sizes ARC allows.
+   */
+  void trimGhosts();
+
+  /**
+   * Number of frames managed by the policy (c in the paper)
+   */
+  std::size_t capacity;
+
+  /**
+   * Target size of T1 (p in the paper)
+   */
+  std::size_t target;
+
+  /**
+   * List each frame is on
+   */
+  std::vector<List> where;
+
+  /**
+   * Position of each frame in its list
+   */
+  std::vector<std::list<FrameId>::iterator> position;
+
+  /**
+   * Key of the page in each frame
+   */
+  std::vector<std::uint64_t> keys;
+
+  /**
+   * Resident lists, most recently used first
+   */
+  std::list<FrameId> t1, t2;
+
+  /**
+   * Ghost lists
+   */
+  Ghosts b1, b2;
+};
+
+}  // namespace badgerdb
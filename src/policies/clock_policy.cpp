@@ -0,0 +1,59 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "policies/clock_policy.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(std::uint32_t frames)
+    : numFrames(frames), clockHand(frames - 1), refbit(frames, false) {}
+
+void ClockPolicy::advanceClock() {
+  clockHand = (clockHand + 1 >= numFrames) ? 0 : clockHand + 1;
+}
+
+void ClockPolicy::recordLoad(FrameId frame, std::uint64_t pageKey) {
+  refbit[frame] = true;
+}
+
+void ClockPolicy::recordAccess(FrameId frame) { refbit[frame] = true; }
+
+void ClockPolicy::recordRemove(FrameId frame) { refbit[frame] = false; }
+
+bool ClockPolicy::pickVictim(std::uint64_t pageKey,
+                             const EvictablePredicate& evictable,
+                             FrameId& frame) {
+  // The first revolution clears every reference bit, so if any frame is
+  // evictable the second revolution is guaranteed to stop at one.
+  for (std::uint64_t step = 0; step < 2 * std::uint64_t(numFrames); step++) {
+    advanceClock();
+    steps++;
+    if (refbit[clockHand]) {
+      refbit[clockHand] = false;
+    } else if (evictable(clockHand)) {
+      frame = clockHand;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockPolicy::resize(std::uint32_t frames) {
+  numFrames = frames;
+  refbit.resize(frames, false);
+  if (clockHand >= frames) {
+    clockHand = frames - 1;
+  }
+}
+
+bool ClockPolicy::sweepPosition(FrameId& frame) const {
+  frame = (clockHand + 1 >= numFrames) ? 0 : clockHand + 1;
+  return true;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,62 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Single reference bit clock sweep.
+ *
+ * The hand skips referenced frames (clearing their bit) and pinned frames,
+ * and stops at the first free or unreferenced, unpinned frame.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of ClockPolicy class
+   *
+   * @param frames  Number of frames managed by the policy
+   */
+  explicit ClockPolicy(std::uint32_t frames);
+
+  void recordLoad(FrameId frame, std::uint64_t pageKey) override;
+  void recordAccess(FrameId frame) override;
+  void recordRemove(FrameId frame) override;
+  bool pickVictim(std::uint64_t pageKey, const EvictablePredicate& evictable,
+                  FrameId& frame) override;
+  void resize(std::uint32_t frames) override;
+  bool sweepPosition(FrameId& frame) const override;
+
+ private:
+  /**
+   * Advance clock to next frame
+   */
+  void advanceClock();
+
+  /**
+   * Number of frames managed by the policy
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * Current position of clockhand
+   */
+  FrameId clockHand;
+
+  /**
+   * Has the frame been referenced since the hand last passed it
+   */
+  std::vector<bool> refbit;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,219 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "policies/clock_pro_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ClockProPolicy::ClockProPolicy(std::uint32_t frames)
+    : capacity(frames),
+      coldTarget(1),
+      numHot(0),
+      numNonResident(0),
+      handHot(ring.end()),
+      handCold(ring.end()),
+      handTest(ring.end()),
+      entryOf(frames),
+      resident(frames, false) {}
+
+void ClockProPolicy::advance(Ring::iterator& hand) {
+  if (ring.empty()) {
+    hand = ring.end();
+    return;
+  }
+  if (hand == ring.end() || ++hand == ring.end()) {
+    hand = ring.begin();
+  }
+}
+
+ClockProPolicy::Ring::iterator ClockProPolicy::insertAtHead(
+    const Entry& entry) {
+  if (ring.empty()) {
+    ring.push_back(entry);
+    handHot = handCold = handTest = ring.begin();
+    return ring.begin();
+  }
+  return ring.insert(handHot, entry);
+}
+
+void ClockProPolicy::erase(Ring::iterator it) {
+  for (Ring::iterator* hand : {&handHot, &handCold, &handTest}) {
+    if (*hand == it) {
+      advance(*hand);
+    }
+  }
+  if (!it->hot && it->frame == NO_FRAME) {
+    nonResident.erase(it->key);
+    numNonResident--;
+  }
+  ring.erase(it);
+  if (ring.empty()) {
+    handHot = handCold = handTest = ring.end();
+  }
+}
+
+void ClockProPolicy::runHandHot() {
+  for (std::size_t left = ring.size(); left > 0; left--) {
+    Ring::iterator e = handHot;
+    advance(handHot);
+    if (e->frame == NO_FRAME) {
+      // A non-resident page whose test period the hot hand outlived.
+      erase(e);
+      coldTarget = std::max<std::size_t>(1, coldTarget - 1);
+    } else if (e->hot) {
+      if (e->ref) {
+        e->ref = false;
+      } else {
+        e->hot = false;
+        e->test = false;
+        numHot--;
+        return;
+      }
+    } else {
+      e->test = false;
+    }
+  }
+}
+
+void ClockProPolicy::runHandTest() {
+  for (std::size_t left = ring.size(); left > 0; left--) {
+    Ring::iterator e = handTest;
+    advance(handTest);
+    if (e->frame == NO_FRAME) {
+      erase(e);
+      coldTarget = std::max<std::size_t>(1, coldTarget - 1);
+      return;
+    }
+    if (!e->hot) {
+      e->test = false;
+    }
+  }
+}
+
+void ClockProPolicy::balanceHot() {
+  const std::size_t hotTarget = capacity > coldTarget ? capacity - coldTarget : 0;
+  while (numHot > hotTarget) {
+    std::size_t before = numHot;
+    runHandHot();
+    if (numHot == before) {
+      break;
+    }
+  }
+}
+
+void ClockProPolicy::recordLoad(FrameId frame, std::uint64_t pageKey) {
+  recordRemove(frame);
+
+  Entry entry = {pageKey, frame, false, true, false};
+  auto ghost = nonResident.find(pageKey);
+  if (ghost != nonResident.end()) {
+    // Reloaded during its test period: it should have stayed, so give cold
+    // pages more room and bring this one back hot.
+    erase(ghost->second);
+    coldTarget = std::min(coldTarget + 1, capacity > 1 ? capacity - 1 : 1);
+    entry.hot = true;
+    entry.test = false;
+    numHot++;
+  }
+  entryOf[frame] = insertAtHead(entry);
+  resident[frame] = true;
+  balanceHot();
+}
+
+void ClockProPolicy::recordAccess(FrameId frame) {
+  if (resident[frame]) {
+    entryOf[frame]->ref = true;
+  }
+}
+
+void ClockProPolicy::recordRemove(FrameId frame) {
+  if (resident[frame]) {
+    if (entryOf[frame]->hot) {
+      numHot--;
+    }
+    erase(entryOf[frame]);
+    resident[frame] = false;
+  }
+}
+
+bool ClockProPolicy::pickVictim(std::uint64_t pageKey,
+                                const EvictablePredicate& evictable,
+                                FrameId& frame) {
+  // Promotions and demotions along the way can send the cold hand around a
+  // few times; if it still finds nothing every resident page is pinned.
+  for (std::size_t left = 4 * ring.size() + 4; left > 0 && !ring.empty();
+       left--) {
+    Ring::iterator e = handCold;
+    advance(handCold);
+    steps++;
+    if (e->frame == NO_FRAME || e->hot) {
+      continue;
+    }
+    if (e->ref) {
+      e->ref = false;
+      if (e->test) {
+        e->hot = true;
+        e->test = false;
+        numHot++;
+        balanceHot();
+      } else {
+        e->test = true;
+        ring.splice(handHot, ring, e);
+      }
+    } else if (evictable(e->frame)) {
+      frame = e->frame;
+      resident[frame] = false;
+      if (e->test) {
+        e->frame = NO_FRAME;
+        nonResident[e->key] = e;
+        numNonResident++;
+        if (numNonResident > capacity) {
+          runHandTest();
+        }
+      } else {
+        erase(e);
+      }
+      return true;
+    }
+  }
+
+  // Every cold page is pinned.  Rather than demoting hot pages one revolution
+  // at a time, take the first unpinned page of any kind.
+  for (Ring::iterator e = ring.begin(); e != ring.end(); ++e) {
+    steps++;
+    if (e->frame != NO_FRAME && evictable(e->frame)) {
+      frame = e->frame;
+      resident[frame] = false;
+      if (e->hot) {
+        numHot--;
+      }
+      erase(e);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockProPolicy::resize(std::uint32_t frames) {
+  capacity = frames;
+  coldTarget = std::min(coldTarget, capacity > 1 ? capacity - 1 : 1);
+  entryOf.resize(frames);
+  resident.resize(frames, false);
+  while (numNonResident > capacity) {
+    std::size_t before = numNonResident;
+    runHandTest();
+    if (numNonResident == before) {
+      break;
+    }
+  }
+  balanceHot();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,141 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief CLOCK-Pro replacement (Jiang, Chen and Zhang).
+ *
+ * All pages sit on one clock.  Resident pages are hot or cold; cold pages
+ * start a test period when loaded, and a cold page that is referenced again
+ * during its test period becomes hot.  Cold pages evicted during their test
+ * period stay on the clock as non-resident entries, and a reload of such a
+ * page grows the share of frames reserved for cold pages.  Three hands walk
+ * the clock: the cold hand picks victims, the hot hand demotes unreferenced
+ * hot pages and the test hand retires non-resident entries.
+ */
+class ClockProPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of ClockProPolicy class
+   *
+   * @param frames  Number of frames managed by the policy
+   */
+  explicit ClockProPolicy(std::uint32_t frames);
+
+  void recordLoad(FrameId frame, std::uint64_t pageKey) override;
+  void recordAccess(FrameId frame) override;
+  void recordRemove(FrameId frame) override;
+  bool pickVictim(std::uint64_t pageKey, const EvictablePredicate& evictable,
+                  FrameId& frame) override;
+  void resize(std::uint32_t frames) override;
+
+ private:
+  /**
+   * Frame number of a non-resident entry
+   */
+  static const FrameId NO_FRAME = ~FrameId(0);
+
+  /**
+   * A page on the clock
+   */
+  struct Entry {
+    std::uint64_t key;
+    FrameId frame;
+    bool hot;
+    bool test;
+    bool ref;
+  };
+
+  typedef std::list<Entry> Ring;
+
+  /**
+   * Move a hand one entry forward, wrapping around
+   */
+  void advance(Ring::iterator& hand);
+
+  /**
+   * Insert an entry at the head of the clock, just behind the hot hand
+   */
+  Ring::iterator insertAtHead(const Entry& entry);
+
+  /**
+   * Remove an entry from the clock, moving any hand that points at it
+   */
+  void erase(Ring::iterator it);
+
+  /**
+   * Run the hot hand until one hot page has been demoted
+   */
+  void runHandHot();
+
+  /**
+   * Run the test hand until one non-resident entry has been retired
+   */
+  void runHandTest();
+
+  /**
+   * Demote hot pages until their number is within the hot target
+   */
+  void balanceHot();
+
+  /**
+   * Number of frames managed by the policy
+   */
+  std::size_t capacity;
+
+  /**
+   * Target number of resident cold pages
+   */
+  std::size_t coldTarget;
+
+  /**
+   * Number of resident hot pages
+   */
+  std::size_t numHot;
+
+  /**
+   * Number of non-resident entries
+   */
+  std::size_t numNonResident;
+
+  /**
+   * The clock
+   */
+  Ring ring;
+
+  /**
+   * The hands
+   */
+  Ring::iterator handHot, handCold, handTest;
+
+  /**
+   * Entry of the page in each frame
+   */
+  std::vector<Ring::iterator> entryOf;
+
+  /**
+   * Does the frame hold a page on the clock
+   */
+  std::vector<bool> resident;
+
+  /**
+   * Non-resident entries by page key
+   */
+  std::unordered_map<std::uint64_t, Ring::iterator> nonResident;
+};
+
+}  // namespace badgerdb
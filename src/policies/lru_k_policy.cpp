@@ -0,0 +1,106 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "policies/lru_k_policy.h"
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(std::uint32_t frames)
+    : numFrames(frames),
+      now(0),
+      history(frames, History()),
+      keys(frames, 0),
+      resident(frames, false) {
+  for (FrameId i = 0; i < frames; i++) {
+    queue.insert(queueKey(i));
+  }
+}
+
+void LruKPolicy::touch(FrameId frame) {
+  History h = history[frame];
+  for (std::uint32_t i = K - 1; i > 0; i--) {
+    h.refs[i] = h.refs[i - 1];
+  }
+  h.refs[0] = ++now;
+  setHistory(frame, h);
+}
+
+void LruKPolicy::setHistory(FrameId frame, const History& h) {
+  queue.erase(queueKey(frame));
+  history[frame] = h;
+  queue.insert(queueKey(frame));
+}
+
+void LruKPolicy::retain(FrameId frame) {
+  retained.emplace_front(keys[frame], history[frame]);
+  auto old = retainedIndex.find(keys[frame]);
+  if (old != retainedIndex.end()) {
+    retained.erase(old->second);
+  }
+  retainedIndex[keys[frame]] = retained.begin();
+  if (retained.size() > numFrames) {
+    retainedIndex.erase(retained.back().first);
+    retained.pop_back();
+  }
+}
+
+void LruKPolicy::recordLoad(FrameId frame, std::uint64_t pageKey) {
+  History h = History();
+  auto it = retainedIndex.find(pageKey);
+  if (it != retainedIndex.end()) {
+    h = it->second->second;
+    retained.erase(it->second);
+    retainedIndex.erase(it);
+  }
+  setHistory(frame, h);
+  touch(frame);
+  keys[frame] = pageKey;
+  resident[frame] = true;
+}
+
+void LruKPolicy::recordAccess(FrameId frame) { touch(frame); }
+
+void LruKPolicy::recordRemove(FrameId frame) {
+  setHistory(frame, History());
+  resident[frame] = false;
+}
+
+bool LruKPolicy::pickVictim(std::uint64_t pageKey,
+                            const EvictablePredicate& evictable,
+                            FrameId& frame) {
+  for (const QueueKey& entry : queue) {
+    FrameId candidate = std::get<2>(entry);
+    steps++;
+    if (resident[candidate] && evictable(candidate)) {
+      retain(candidate);
+      recordRemove(candidate);
+      frame = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void LruKPolicy::resize(std::uint32_t frames) {
+  for (FrameId i = frames; i < numFrames; i++) {
+    queue.erase(queueKey(i));
+  }
+  history.resize(frames, History());
+  keys.resize(frames, 0);
+  resident.resize(frames, false);
+  for (FrameId i = numFrames; i < frames; i++) {
+    queue.insert(queueKey(i));
+  }
+  numFrames = frames;
+  while (retained.size() > numFrames) {
+    retainedIndex.erase(retained.back().first);
+    retained.pop_back();
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,130 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief LRU-K replacement (O'Neil, O'Neil and Weikum).
+ *
+ * Evicts the page whose K-th most recent reference is furthest in the past.
+ * Pages with fewer than K references have an infinite backward K-distance and
+ * are evicted first, in LRU order.  The reference history of evicted pages is
+ * retained for up to one pool's worth of pages so that a page that is re-read
+ * soon after eviction does not start over as a one-time reference.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Number of references tracked per page
+   */
+  static const std::uint32_t K = 2;
+
+  /**
+   * Constructor of LruKPolicy class
+   *
+   * @param frames  Number of frames managed by the policy
+   */
+  explicit LruKPolicy(std::uint32_t frames);
+
+  void recordLoad(FrameId frame, std::uint64_t pageKey) override;
+  void recordAccess(FrameId frame) override;
+  void recordRemove(FrameId frame) override;
+  bool pickVictim(std::uint64_t pageKey, const EvictablePredicate& evictable,
+                  FrameId& frame) override;
+  void resize(std::uint32_t frames) override;
+
+ private:
+  /**
+   * Reference times of a page, most recent first.  Zero means no reference.
+   */
+  struct History {
+    std::uint64_t refs[K];
+  };
+
+  /**
+   * Eviction order: (K-th reference time, last reference time, frame)
+   */
+  typedef std::tuple<std::uint64_t, std::uint64_t, FrameId> QueueKey;
+
+  /**
+   * Position of frame in the eviction queue
+   */
+  QueueKey queueKey(FrameId frame) const {
+    return QueueKey(history[frame].refs[K - 1], history[frame].refs[0], frame);
+  }
+
+  /**
+   * Record a reference to frame at the current time, keeping the queue in
+   * order.
+   */
+  void touch(FrameId frame);
+
+  /**
+   * Set the history of frame, keeping the queue in order.
+   */
+  void setHistory(FrameId frame, const History& h);
+
+  /**
+   * Remember the history of the page in frame after it has been evicted.
+   */
+  void retain(FrameId frame);
+
+  /**
+   * Number of frames managed by the policy
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * Logical clock, advanced on every reference
+   */
+  std::uint64_t now;
+
+  /**
+   * Reference history of the page in each frame
+   */
+  std::vector<History> history;
+
+  /**
+   * Key of the page in each frame
+   */
+  std::vector<std::uint64_t> keys;
+
+  /**
+   * Does the frame hold a page
+   */
+  std::vector<bool> resident;
+
+  /**
+   * All frames ordered by eviction priority
+   */
+  std::set<QueueKey> queue;
+
+  /**
+   * Histories of evicted pages, most recently evicted first
+   */
+  std::list<std::pair<std::uint64_t, History>> retained;
+
+  /**
+   * Index into retained by page key
+   */
+  std::unordered_map<std::uint64_t,
+                     std::list<std::pair<std::uint64_t, History>>::iterator>
+      retainedIndex;
+};
+
+}  // namespace badgerdb
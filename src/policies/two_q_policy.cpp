@@ -0,0 +1,101 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "policies/two_q_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(std::uint32_t frames)
+    : kin(std::max<std::size_t>(1, frames / 4)),
+      kout(std::max<std::size_t>(1, frames / 2)),
+      where(frames, NONE),
+      position(frames),
+      keys(frames, 0) {}
+
+void TwoQPolicy::unlink(FrameId frame) {
+  if (where[frame] == A1IN) {
+    a1in.erase(position[frame]);
+  } else if (where[frame] == AM) {
+    am.erase(position[frame]);
+  }
+  where[frame] = NONE;
+}
+
+void TwoQPolicy::recordLoad(FrameId frame, std::uint64_t pageKey) {
+  unlink(frame);
+  keys[frame] = pageKey;
+  auto ghost = a1outIndex.find(pageKey);
+  if (ghost != a1outIndex.end()) {
+    a1out.erase(ghost->second);
+    a1outIndex.erase(ghost);
+    am.push_front(frame);
+    position[frame] = am.begin();
+    where[frame] = AM;
+  } else {
+    a1in.push_front(frame);
+    position[frame] = a1in.begin();
+    where[frame] = A1IN;
+  }
+}
+
+void TwoQPolicy::recordAccess(FrameId frame) {
+  // Re-references while in A1in are considered correlated and ignored.
+  if (where[frame] == AM) {
+    am.splice(am.begin(), am, position[frame]);
+  }
+}
+
+void TwoQPolicy::recordRemove(FrameId frame) { unlink(frame); }
+
+bool TwoQPolicy::evictFrom(std::list<FrameId>& queue,
+                           const EvictablePredicate& evictable,
+                           FrameId& frame) {
+  for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+    steps++;
+    if (evictable(*it)) {
+      frame = *it;
+      if (where[frame] == A1IN) {
+        a1out.push_front(keys[frame]);
+        a1outIndex[keys[frame]] = a1out.begin();
+        if (a1out.size() > kout) {
+          a1outIndex.erase(a1out.back());
+          a1out.pop_back();
+        }
+      }
+      unlink(frame);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TwoQPolicy::pickVictim(std::uint64_t pageKey,
+                            const EvictablePredicate& evictable,
+                            FrameId& frame) {
+  if (a1in.size() > kin) {
+    return evictFrom(a1in, evictable, frame) ||
+           evictFrom(am, evictable, frame);
+  }
+  return evictFrom(am, evictable, frame) || evictFrom(a1in, evictable, frame);
+}
+
+void TwoQPolicy::resize(std::uint32_t frames) {
+  kin = std::max<std::size_t>(1, frames / 4);
+  kout = std::max<std::size_t>(1, frames / 2);
+  where.resize(frames, NONE);
+  position.resize(frames);
+  keys.resize(frames, 0);
+  while (a1out.size() > kout) {
+    a1outIndex.erase(a1out.back());
+    a1out.pop_back();
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,109 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Full 2Q replacement (Johnson and Shasha).
+ *
+ * First-time pages enter the A1in FIFO.  Pages evicted from A1in are
+ * remembered in the A1out ghost queue, and a page that is loaded again while
+ * still in A1out is promoted to the Am LRU queue.  A scan therefore only
+ * churns A1in and leaves the pages in Am alone.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of TwoQPolicy class
+   *
+   * @param frames  Number of frames managed by the policy
+   */
+  explicit TwoQPolicy(std::uint32_t frames);
+
+  void recordLoad(FrameId frame, std::uint64_t pageKey) override;
+  void recordAccess(FrameId frame) override;
+  void recordRemove(FrameId frame) override;
+  bool pickVictim(std::uint64_t pageKey, const EvictablePredicate& evictable,
+                  FrameId& frame) override;
+  void resize(std::uint32_t frames) override;
+
+ private:
+  /**
+   * Queue a frame is on
+   */
+  enum Queue { NONE, A1IN, AM };
+
+  /**
+   * Evict the least recently inserted or used evictable frame of a queue.
+   *
+   * @return  False if the queue has no evictable frame
+   */
+  bool evictFrom(std::list<FrameId>& queue, const EvictablePredicate& evictable,
+                 FrameId& frame);
+
+  /**
+   * Unlink frame from whichever queue it is on.
+   */
+  void unlink(FrameId frame);
+
+  /**
+   * Target size of A1in, a quarter of the frames
+   */
+  std::size_t kin;
+
+  /**
+   * Maximum size of A1out, half of the frames
+   */
+  std::size_t kout;
+
+  /**
+   * Queue each frame is on
+   */
+  std::vector<Queue> where;
+
+  /**
+   * Position of each frame in its queue
+   */
+  std::vector<std::list<FrameId>::iterator> position;
+
+  /**
+   * Key of the page in each frame
+   */
+  std::vector<std::uint64_t> keys;
+
+  /**
+   * FIFO of pages seen once, newest first
+   */
+  std::list<FrameId> a1in;
+
+  /**
+   * LRU of pages seen more than once, most recently used first
+   */
+  std::list<FrameId> am;
+
+  /**
+   * Ghost FIFO of keys evicted from A1in, newest first
+   */
+  std::list<std::uint64_t> a1out;
+
+  /**
+   * Index into a1out by page key
+   */
+  std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator>
+      a1outIndex;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,36 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include "policies/arc_policy.h"
+#include "policies/clock_policy.h"
+#include "policies/clock_pro_policy.h"
+#include "policies/lru_k_policy.h"
+#include "policies/two_q_policy.h"
+
+namespace badgerdb {
+
+std::unique_ptr<ReplacementPolicy> makeReplacementPolicy(
+    ReplacementPolicyType type, std::uint32_t frames) {
+  switch (type) {
+    case ReplacementPolicyType::LRU_K:
+      return std::unique_ptr<ReplacementPolicy>(new LruKPolicy(frames));
+    case ReplacementPolicyType::TWO_Q:
+      return std::unique_ptr<ReplacementPolicy>(new TwoQPolicy(frames));
+    case ReplacementPolicyType::ARC:
+      return std::unique_ptr<ReplacementPolicy>(new ArcPolicy(frames));
+    case ReplacementPolicyType::CLOCK_PRO:
+      return std::unique_ptr<ReplacementPolicy>(new ClockProPolicy(frames));
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return std::unique_ptr<ReplacementPolicy>(new ClockPolicy(frames));
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,156 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Replacement policies the buffer manager can be configured with.
+ */
+enum class ReplacementPolicyType {
+  /**
+   * Single reference bit clock sweep
+   */
+  CLOCK,
+
+  /**
+   * LRU-K with K = 2 and retained history for recently evicted pages
+   */
+  LRU_K,
+
+  /**
+   * Full 2Q with an A1in FIFO, an A1out ghost queue and an Am LRU queue
+   */
+  TWO_Q,
+
+  /**
+   * Adaptive Replacement Cache
+   */
+  ARC,
+
+  /**
+   * CLOCK-Pro with hot, cold and test hands
+   */
+  CLOCK_PRO
+};
+
+/**
+ * @brief Interface for choosing which buffer frame to evict.
+ *
+ * A policy manages a fixed set of frames numbered 0 to frames-1.  The buffer
+ * manager reports every page load, hit and explicit removal, and asks the
+ * policy for a victim when it needs a frame.  Pages are identified to the
+ * policy by a 64 bit key so that policies can keep history (ghost entries) for
+ * pages that are no longer resident.
+ *
+ * Frames that do not hold a page are handed out by the owner itself, so
+ * pickVictim() is only called once every frame holds a page.  A policy must
+ * never return a frame for which the evictable predicate is false.
+ *
+ * @warning This class is not threadsafe; the owner serializes all calls.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Tells whether the page in a frame may be evicted, ie. it is unpinned.
+   */
+  typedef std::function<bool(FrameId)> EvictablePredicate;
+
+  ReplacementPolicy() : steps(0) {}
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Page with key pageKey has been loaded into frame.
+   *
+   * @param frame   Frame the page was loaded into
+   * @param pageKey Key of the page
+   */
+  virtual void recordLoad(FrameId frame, std::uint64_t pageKey) = 0;
+
+  /**
+   * The page in frame has been accessed again (a buffer hit).
+   *
+   * @param frame   Frame that was hit
+   */
+  virtual void recordAccess(FrameId frame) = 0;
+
+  /**
+   * The page in frame has been dropped from the pool without going through
+   * pickVictim(), eg. by flushFile() or disposePage().  The frame is free
+   * until it is passed to recordLoad() again.
+   *
+   * @param frame   Frame that no longer holds a page
+   */
+  virtual void recordRemove(FrameId frame) = 0;
+
+  /**
+   * Choose the frame whose page is evicted to make room for the page with key
+   * pageKey.
+   *
+   * @param pageKey   Key of the page that is about to be loaded
+   * @param evictable Predicate telling which frames may be chosen
+   * @param frame     Frame reference, chosen frame returned via this variable
+   * @return          False if no frame can be chosen
+   */
+  virtual bool pickVictim(std::uint64_t pageKey,
+                          const EvictablePredicate& evictable,
+                          FrameId& frame) = 0;
+
+  /**
+   * Change the number of frames managed by the policy.  When shrinking, the
+   * frames that go away no longer hold a page, ie. they have been passed to
+   * recordRemove() or were never loaded.  Frames that are added do not hold
+   * a page either.  History kept for pages that are not resident is trimmed
+   * to the new size.
+   *
+   * @param frames  New number of frames, at least 1
+   */
+  virtual void resize(std::uint32_t frames) = 0;
+
+  /**
+   * Frame at which a sweep over the frames in order should start so that it
+   * reaches the likely victims first.  Used by the background writer to clean
+   * pages ahead of victim selection.
+   *
+   * @param frame   Frame reference, starting frame returned via this variable
+   * @return        False if the policy does not evict in frame order
+   */
+  virtual bool sweepPosition(FrameId& frame) const { return false; }
+
+  /**
+   * Returns the number of frames pickVictim() has looked at so far.
+   */
+  std::uint64_t sweepSteps() const { return steps; }
+
+ protected:
+  /**
+   * Number of frames looked at by pickVictim(); incremented by the policies
+   * for every candidate they examine.
+   */
+  std::uint64_t steps;
+};
+
+/**
+ * Creates a replacement policy managing the given number of frames.
+ *
+ * @param type    Policy to create
+ * @param frames  Number of frames managed by the policy
+ * @return        The policy
+ */
+std::unique_ptr<ReplacementPolicy> makeReplacementPolicy(
+    ReplacementPolicyType type, std::uint32_t frames);
+
+}  // namespace badgerdb
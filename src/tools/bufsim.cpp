@@ -0,0 +1,285 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Replays a buffer access trace recorded with BufMgr::startTrace() against
+ * buffer pools of different sizes and replacement policies, without any I/O,
+ * and prints the hit ratio and write-backs of each combination.
+ *
+ * Usage: bufsim TRACE [-p POLICY,...] [-s FRAMES,...]
+ *
+ * POLICY is one of clock, lru-k, 2q, arc and clock-pro; all of them are
+ * simulated by default.  By default the pool sizes are 1/16, 1/8, 1/4, 1/2
+ * and all of the distinct pages in the trace.  The pool is simulated as a
+ * single shard.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buf_trace.h"
+#include "exceptions/badgerdb_exception.h"
+#include "replacement_policy.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct PolicyName {
+  const char* name;
+  ReplacementPolicyType type;
+};
+
+const PolicyName POLICIES[] = {
+    {"clock", ReplacementPolicyType::CLOCK},
+    {"lru-k", ReplacementPolicyType::LRU_K},
+    {"2q", ReplacementPolicyType::TWO_Q},
+    {"arc", ReplacementPolicyType::ARC},
+    {"clock-pro", ReplacementPolicyType::CLOCK_PRO}};
+
+/**
+ * Outcome of one replay.
+ */
+struct SimResult {
+  std::uint64_t accesses = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  std::uint64_t evictions = 0;
+  std::uint64_t writeBacks = 0;
+  std::uint64_t bufferExceeded = 0;
+};
+
+/**
+ * State of a simulated frame.
+ */
+struct SimFrame {
+  std::uint64_t key = 0;
+  std::uint32_t pinCnt = 0;
+  bool dirty = false;
+  bool valid = false;
+};
+
+std::uint64_t pageKey(std::uint32_t file, PageId pageNo) {
+  return (std::uint64_t(file) << 32) | pageNo;
+}
+
+/**
+ * Buffer pool that tracks which pages are resident, like BufMgr does, but
+ * holds no page contents.
+ */
+class SimPool {
+ public:
+  SimPool(ReplacementPolicyType type, std::uint32_t size)
+      : frames(size), policy(makeReplacementPolicy(type, size)) {
+    for (std::uint32_t i = size; i > 0; i--) {
+      freeFrames.push_back(i - 1);
+    }
+  }
+
+  void apply(const BufTraceEvent& event) {
+    const std::uint64_t key = pageKey(event.file, event.pageNo);
+    auto it = table.find(key);
+    switch (event.op) {
+      case BufTraceOp::READ:
+        result.accesses++;
+        if (it != table.end()) {
+          result.hits++;
+          frames[it->second].pinCnt++;
+          policy->recordAccess(it->second);
+          break;
+        }
+        result.misses++;
+        load(key);
+        break;
+      case BufTraceOp::ALLOC:
+        result.accesses++;
+        if (it == table.end()) {
+          load(key);
+        }
+        break;
+      case BufTraceOp::UNPIN:
+        if (it != table.end() && frames[it->second].pinCnt > 0) {
+          frames[it->second].pinCnt--;
+          frames[it->second].dirty |= event.dirty;
+        }
+        break;
+      case BufTraceOp::DISPOSE:
+        if (it != table.end()) {
+          drop(it->second);
+        }
+        break;
+      case BufTraceOp::FLUSH:
+        for (FrameId f = 0; f < frames.size(); f++) {
+          if (frames[f].valid && frames[f].key >> 32 == event.file) {
+            drop(f);
+          }
+        }
+        break;
+    }
+  }
+
+  const SimResult& stats() const { return result; }
+
+ private:
+  void load(std::uint64_t key) {
+    FrameId f;
+    if (!freeFrames.empty()) {
+      f = freeFrames.back();
+      freeFrames.pop_back();
+    } else {
+      bool found = policy->pickVictim(
+          key,
+          [this](FrameId i) {
+            return frames[i].valid && frames[i].pinCnt == 0;
+          },
+          f);
+      if (!found) {
+        result.bufferExceeded++;
+        return;
+      }
+      result.evictions++;
+      if (frames[f].dirty) {
+        result.writeBacks++;
+      }
+      table.erase(frames[f].key);
+    }
+    frames[f].key = key;
+    frames[f].pinCnt = 1;
+    frames[f].dirty = false;
+    frames[f].valid = true;
+    table[key] = f;
+    policy->recordLoad(f, key);
+  }
+
+  void drop(FrameId f) {
+    table.erase(frames[f].key);
+    frames[f] = SimFrame();
+    policy->recordRemove(f);
+    freeFrames.push_back(f);
+  }
+
+  std::vector<SimFrame> frames;
+  std::vector<FrameId> freeFrames;
+  std::unordered_map<std::uint64_t, FrameId> table;
+  std::unique_ptr<ReplacementPolicy> policy;
+  SimResult result;
+};
+
+std::vector<std::string> split(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+int usage() {
+  std::cerr << "usage: bufsim TRACE [-p POLICY,...] [-s FRAMES,...]\n"
+            << "policies: clock, lru-k, 2q, arc, clock-pro\n";
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    return usage();
+  }
+  const std::string path = argv[1];
+  std::vector<PolicyName> policies;
+  std::vector<std::uint32_t> sizes;
+  for (int i = 2; i < argc; i++) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc || (flag != "-p" && flag != "-s")) {
+      return usage();
+    }
+    for (const std::string& item : split(argv[++i])) {
+      if (flag == "-s") {
+        const long frames = std::strtol(item.c_str(), NULL, 10);
+        if (frames <= 0) {
+          return usage();
+        }
+        sizes.push_back(frames);
+        continue;
+      }
+      bool known = false;
+      for (const PolicyName& policy : POLICIES) {
+        if (item == policy.name) {
+          policies.push_back(policy);
+          known = true;
+        }
+      }
+      if (!known) {
+        return usage();
+      }
+    }
+  }
+  if (policies.empty()) {
+    policies.assign(std::begin(POLICIES), std::end(POLICIES));
+  }
+
+  std::vector<BufTraceEvent> events;
+  std::unordered_set<std::uint64_t> pages;
+  try {
+    BufTraceReader reader(path);
+    BufTraceEvent event;
+    while (reader.next(event)) {
+      events.push_back(event);
+      if (event.op == BufTraceOp::READ || event.op == BufTraceOp::ALLOC) {
+        pages.insert(pageKey(event.file, event.pageNo));
+      }
+    }
+  } catch (const BadgerDbException& e) {
+    std::cerr << e.message() << "\n";
+    return 1;
+  }
+  if (sizes.empty()) {
+    for (std::uint32_t div = 16; div >= 1; div /= 2) {
+      sizes.push_back(std::max<std::size_t>(1, pages.size() / div));
+    }
+  }
+
+  std::cout << events.size() << " events, " << pages.size()
+            << " distinct pages\n\n"
+            << std::left << std::setw(10) << "policy" << std::right
+            << std::setw(10) << "frames" << std::setw(12) << "accesses"
+            << std::setw(12) << "hits" << std::setw(9) << "hit %"
+            << std::setw(12) << "evictions" << std::setw(12) << "writebacks"
+            << std::setw(10) << "exceeded"
+            << "\n";
+  for (const PolicyName& policy : policies) {
+    for (std::uint32_t frames : sizes) {
+      SimPool pool(policy.type, frames);
+      for (const BufTraceEvent& event : events) {
+        pool.apply(event);
+      }
+      const SimResult& r = pool.stats();
+      const double hitRatio =
+          r.accesses ? 100.0 * r.hits / r.accesses : 0.0;
+      std::cout << std::left << std::setw(10) << policy.name << std::right
+                << std::setw(10) << frames << std::setw(12) << r.accesses
+                << std::setw(12) << r.hits << std::setw(9) << std::fixed
+                << std::setprecision(2) << hitRatio << std::setw(12)
+                << r.evictions << std::setw(12) << r.writeBacks
+                << std::setw(10) << r.bufferExceeded << "\n";
+    }
+  }
+  return 0;
+}
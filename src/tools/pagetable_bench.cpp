@@ -0,0 +1,223 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Measures page table lookup throughput as the number of threads grows, for
+ * ConcurrentPageTable and for a BufHashTbl behind a mutex, with and without a
+ * thread that keeps inserting and removing other pages meanwhile.
+ *
+ * Usage: pagetable_bench [-t THREADS] [-n PAGES] [-o LOOKUPS]
+ *
+ * Thread counts double from 1 up to THREADS, which defaults to the number of
+ * hardware threads.  PAGES (default 65536) pages are in the table, and every
+ * thread makes LOOKUPS (default 2000000) lookups of random ones.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "concurrent_page_table.h"
+#include "exceptions/badgerdb_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "pagetable_bench.db";
+
+/**
+ * Page table under test; lookups are called from many threads.
+ */
+class Table {
+ public:
+  virtual ~Table() {}
+  virtual bool lookup(const File& file, PageId pageNo, FrameId& frame) = 0;
+  virtual void insert(const File& file, PageId pageNo, FrameId frame) = 0;
+  virtual void remove(const File& file, PageId pageNo) = 0;
+};
+
+class Concurrent : public Table {
+ public:
+  explicit Concurrent(std::uint32_t pages) : table(pages * 2) {}
+  bool lookup(const File& file, PageId pageNo, FrameId& frame) override {
+    return table.lookup(file, pageNo, frame);
+  }
+  void insert(const File& file, PageId pageNo, FrameId frame) override {
+    table.insert(file, pageNo, frame);
+  }
+  void remove(const File& file, PageId pageNo) override {
+    table.remove(file, pageNo);
+  }
+
+ private:
+  ConcurrentPageTable table;
+};
+
+class Latched : public Table {
+ public:
+  explicit Latched(std::uint32_t pages) : table(pages * 2) {}
+  bool lookup(const File& file, PageId pageNo, FrameId& frame) override {
+    std::lock_guard<std::mutex> lock(latch);
+    return table.tryLookup(file, pageNo, frame);
+  }
+  void insert(const File& file, PageId pageNo, FrameId frame) override {
+    std::lock_guard<std::mutex> lock(latch);
+    table.tryInsert(file, pageNo, frame);
+  }
+  void remove(const File& file, PageId pageNo) override {
+    std::lock_guard<std::mutex> lock(latch);
+    table.tryRemove(file, pageNo);
+  }
+
+ private:
+  std::mutex latch;
+  BufHashTbl table;
+};
+
+/**
+ * Returns millions of lookups per second over all threads.
+ */
+double run(Table& table, const File& file, std::uint32_t pages,
+           std::uint32_t threads, std::uint64_t lookups, bool churn) {
+  std::atomic<bool> stop(false);
+  std::thread writer;
+  if (churn) {
+    // pages above the looked up ones come and go
+    writer = std::thread([&table, &file, &stop, pages] {
+      PageId next = pages + 1;
+      while (!stop.load(std::memory_order_relaxed)) {
+        table.insert(file, next, next);
+        table.remove(file, next);
+        next = next == pages * 2 ? pages + 1 : next + 1;
+      }
+    });
+  }
+
+  std::atomic<std::uint64_t> misses(0);
+  std::vector<std::thread> readers;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t t = 0; t < threads; t++) {
+    readers.emplace_back([&table, &file, &misses, pages, lookups, t] {
+      std::uint32_t state = 2463534242u + t;
+      std::uint64_t missed = 0;
+      for (std::uint64_t i = 0; i < lookups; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        FrameId frame;
+        if (!table.lookup(file, state % pages + 1, frame)) {
+          missed++;
+        }
+      }
+      misses += missed;
+    });
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  stop = true;
+  if (writer.joinable()) {
+    writer.join();
+  }
+  if (misses != 0) {
+    std::cerr << "lookups missed pages that are in the table\n";
+    std::exit(1);
+  }
+  return threads * lookups / elapsed.count() / 1e6;
+}
+
+int usage() {
+  std::cerr << "usage: pagetable_bench [-t THREADS] [-n PAGES] [-o LOOKUPS]\n";
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::uint32_t maxThreads =
+      std::max(1u, std::thread::hardware_concurrency());
+  std::uint32_t pages = 65536;
+  std::uint64_t lookups = 2000000;
+  for (int i = 1; i < argc; i++) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+      return usage();
+    }
+    const long value = std::strtol(argv[++i], NULL, 10);
+    if (value <= 0) {
+      return usage();
+    }
+    if (flag == "-t") {
+      maxThreads = value;
+    } else if (flag == "-n") {
+      pages = value;
+    } else if (flag == "-o") {
+      lookups = value;
+    } else {
+      return usage();
+    }
+  }
+
+  try {
+    if (File::exists(FILENAME)) {
+      File::remove(FILENAME);
+    }
+    {
+      // only the file's number is used
+      File file = File::create(FILENAME);
+      Concurrent concurrent(pages);
+      Latched latched(pages);
+      for (PageId j = 1; j <= pages; j++) {
+        concurrent.insert(file, j, j);
+        latched.insert(file, j, j);
+      }
+
+      std::cout << pages << " pages, " << lookups
+                << " lookups per thread, million lookups per second\n\n"
+                << std::setw(8) << "threads" << std::setw(14) << "concurrent"
+                << std::setw(14) << "+ writer" << std::setw(14) << "latched"
+                << std::setw(14) << "+ writer"
+                << "\n";
+      for (std::uint32_t threads = 1;; threads = std::min(threads * 2,
+                                                          maxThreads)) {
+        std::cout << std::setw(8) << threads << std::fixed
+                  << std::setprecision(2);
+        std::cout << std::setw(14)
+                  << run(concurrent, file, pages, threads, lookups, false)
+                  << std::setw(14)
+                  << run(concurrent, file, pages, threads, lookups, true)
+                  << std::setw(14)
+                  << run(latched, file, pages, threads, lookups, false)
+                  << std::setw(14)
+                  << run(latched, file, pages, threads, lookups, true)
+                  << "\n";
+        if (threads == maxThreads) {
+          break;
+        }
+      }
+    }
+    File::remove(FILENAME);
+  } catch (const BadgerDbException& e) {
+    std::cerr << e.message() << "\n";
+    return 1;
+  }
+  return 0;
+}